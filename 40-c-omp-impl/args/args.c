@@ -1,12 +1,14 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
 
 #include "args.h"
 
 void print_usage();
 
 int parse_args(int argc, char* argv[], mat_arg* args){
-    unsigned short i;
+    int i;
     for (i = 1; i < argc; i++) {
         if(argv[i][0] != '-') continue;
         
@@ -16,7 +18,18 @@ int parse_args(int argc, char* argv[], mat_arg* args){
             print_usage();
             return EXIT_FAILURE;
         }
-        unsigned short value = atoi(argv[i+1]);
+        // the whole value has to be a number
+        char* end;
+        errno = 0;
+        long long parsed = strtoll(argv[i+1], &end, 10);
+        if (end == argv[i+1] || *end != '\0' || errno == ERANGE) {
+            fprintf(stderr, "Invalid value for argument with name %s: %s\n", argv[i], argv[i+1]);
+            print_usage();
+            return EXIT_FAILURE;
+        }
+        int64_t value = parsed;
+        // sizes and block sizes have to be positive, counts may be 0 and are passed on as int
+        int64_t min = 1, max = INT64_MAX;
         // fill the args struct
         switch (argv[i][1]) {
             case 'm': args->m = value; break;
@@ -24,16 +37,25 @@ int parse_args(int argc, char* argv[], mat_arg* args){
             case 'q': args->q = value; break;
             case 'a': args->row_split = value; break;
             case 'b': args->col_split = value; break;
-            case 'v': args->max_float = value; break;
+            case 'v': args->max_float = value; min = 0; break;
+            case 'p': args->procs = value; min = 0; max = INT_MAX; break;
+            case 'd': args->daemon = value; min = 0; break;
+            case 'c': args->clients = value; min = 0; max = INT_MAX; break;
+            case 'f': args->verify = value; min = 0; max = INT_MAX; break;
             default:
                 print_usage();
                 return EXIT_FAILURE;
         }   
+        if (value < min || value > max) {
+            fprintf(stderr, "Value for argument with name %s out of range: %s\n", argv[i], argv[i+1]);
+            print_usage();
+            return EXIT_FAILURE;
+        }
     }
 
     return EXIT_SUCCESS;
 }
 
 void print_usage(){
-    fprintf(stderr, "Usage: {executable} [[-mnqabv] <value>, ..]]\n\tMultiply matrix A (<m> rows and <n> columns) with matrix B (<n> rows and <q> columns)\n\tsplitting matrix A alongside its rows by <a> and alongside its columns by <b>.\n\tInitialize matrices A and B with random float32 not exceeding <v>");
+    fprintf(stderr, "Usage: {executable} [[-mnqabvpdcf] <value>, ..]]\n\tMultiply matrix A (<m> rows and <n> columns) with matrix B (<n> rows and <q> columns)\n\tsplitting matrix A alongside its rows by <a> and alongside its columns by <b>.\n\tInitialize matrices A and B with random float32 not exceeding <v>.\n\tReport strong and weak scaling of the distributed algorithm for up to <p> processes (0 to disable).\n\tWith <d> = 1 run as multiplication service on the socket given by MATRIXMUL_SOCKET (default /tmp/matrixmul.sock).\n\tWith <c> > 0 benchmark a running service with <c> concurrent clients.\n\tVerify every result with <f> rounds of Freivalds' algorithm (0 to disable)");
 }
\ No newline at end of file
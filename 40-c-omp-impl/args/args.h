@@ -1,10 +1,16 @@
+#include <stdint.h>
+
 typedef struct mat_arg{
-    unsigned int m;
-    unsigned int n;
-    unsigned int q;
-    unsigned int row_split;
-    unsigned int col_split;
-    unsigned int max_float;
+    int64_t m;
+    int64_t n;
+    int64_t q;
+    int64_t row_split;
+    int64_t col_split;
+    int64_t max_float;
+    int64_t procs;
+    int64_t daemon;
+    int64_t clients;
+    int64_t verify;
 } mat_arg;
 
 int parse_args(int argc, char* argv[], mat_arg* args);
@@ -1,6 +1,7 @@
 #include "format.h"
 #include <math.h>
 #include <stdio.h>
+#include <inttypes.h>
 
 /**
  * @brief Print a matrix struct including horizontal and vertical lines which show how
@@ -11,16 +12,16 @@
  * @param col_split can be negative to disable splitting along rows
  * @param max_len maximum number of columns or rows to print
  */
-void print_matrix(char name, matrix* mat, long row_split, long col_split, long max_len){
-    long max_row = fminl(mat->rows, max_len);
-    long max_col = fminl(mat->cols, max_len);
-    fprintf(stdout, "###\n#Printing matrix \"%c\" with \"rows: %ld, cols: %ld, row_split: %ld, col_split: %ld\"\n###\n", name, mat->rows, mat->cols, row_split, col_split);
+void print_matrix(char name, matrix* mat, mat_index row_split, mat_index col_split, mat_index max_len){
+    mat_index max_row = MIN(mat->rows, max_len);
+    mat_index max_col = MIN(mat->cols, max_len);
+    fprintf(stdout, "###\n#Printing matrix \"%c\" with \"rows: %" PRId64 ", cols: %" PRId64 ", row_split: %" PRId64 ", col_split: %" PRId64 "\"\n###\n", name, mat->rows, mat->cols, row_split, col_split);
 
     // For each row
-    for(int i = 0; i < max_row; i++){
+    for(mat_index i = 0; i < max_row; i++){
         // Print horizontal split line
         if(row_split > 0 && i != 0 && i % row_split == 0){
-            for(int k = 0; k < max_col; k++){
+            for(mat_index k = 0; k < max_col; k++){
                 // compensate for the "| " pattern (two characters)
                 if(k != 0 && k % col_split == 0){
                     fprintf(stdout, "- ");
@@ -31,7 +32,7 @@ void print_matrix(char name, matrix* mat, long row_split, long col_split, long m
         }
         
         // For each col
-        for(int j = 0; j < max_col; j++){
+        for(mat_index j = 0; j < max_col; j++){
             // Print vertical split line
             if(col_split > 0 && j != 0 && j % col_split == 0){
                 fprintf(stdout, "| ");
@@ -50,17 +51,17 @@ void print_matrix(char name, matrix* mat, long row_split, long col_split, long m
  * @param mat 
  * @param max_len 
  */
-void print_split_matrix(char name, split_matrix* mat, long max_len){
-    long max_row = fminl(mat->rows, max_len);
-    long max_col = fminl(mat->cols, max_len);
-    fprintf(stdout, "###\n#Printing split-matrix \"%c\" with \"rows: %ld, cols: %ld\"\n###\n", name, mat->rows, mat->cols);
+void print_split_matrix(char name, split_matrix* mat, mat_index max_len){
+    mat_index max_row = MIN(mat->rows, max_len);
+    mat_index max_col = MIN(mat->cols, max_len);
+    fprintf(stdout, "###\n#Printing split-matrix \"%c\" with \"rows: %" PRId64 ", cols: %" PRId64 "\"\n###\n", name, mat->rows, mat->cols);
 
     // For each row
-    for(int i = 0; i < max_row; i++){
+    for(mat_index i = 0; i < max_row; i++){
         // For each col
-        for(int j = 0; j < max_col; j++){
+        for(mat_index j = 0; j < max_col; j++){
             sub_matrix_meta* p = &mat->data[MIDX(i, j, mat->cols)];
-            fprintf(stdout, "%c%d%d[[%ld,%ld],[%ld,%ld]] ", name, i, j, p->col_start, p->col_end, p->row_start, p->row_end);
+            fprintf(stdout, "%c%" PRId64 "%" PRId64 "[[%" PRId64 ",%" PRId64 "],[%" PRId64 ",%" PRId64 "]] ", name, i, j, p->col_start, p->col_end, p->row_start, p->row_end);
         }
         fprintf(stdout, "\n");
     }
@@ -1,4 +1,4 @@
 #include <matrix/matrix.h>
 
-void print_split_matrix(char name, split_matrix* mat, long max_len);
-void print_matrix(char name, matrix* mat, long row_split, long col_split, long max_len);
\ No newline at end of file
+void print_split_matrix(char name, split_matrix* mat, mat_index max_len);
+void print_matrix(char name, matrix* mat, mat_index row_split, mat_index col_split, mat_index max_len);
\ No newline at end of file
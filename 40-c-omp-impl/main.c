@@ -4,6 +4,7 @@
 #include <float.h>
 #include <math.h>
 #include <time.h>
+#include <inttypes.h>
 
 #ifdef _WIN32
 #include <Windows.h>
@@ -14,25 +15,70 @@
 
 #include "args/args.h"
 #include "matrix/matrix.h"
+#ifdef WITH_SUMMA
+#include "summa/summa.h"
+#endif
+#ifdef WITH_SERVICE
+#include "service/service.h"
+#endif
 
 #define DEV_SEED 11
+#define SERVICE_ROUNDS 100
+
+/**
+ * @brief Check the result of a benchmark run with Freivalds' algorithm if enabled
+ * 
+ * @param args 
+ * @param A 
+ * @param B 
+ * @param C 
+ */
+static void verify_result(mat_arg* args, matrix* A, matrix* B, matrix* C){
+    if(args->verify <= 0) return;
+
+    double verify_time = omp_get_wtime();
+    int res = matrix_freivalds_verify(A, B, C, (int) args->verify);
+    verify_time = omp_get_wtime() - verify_time;
+    fprintf(stdout, "Verification with %" PRId64 " Freivalds rounds %s, took \"%04.2f\" s\n", args->verify, res == EXIT_SUCCESS ? "passed" : "FAILED", verify_time);
+}
 
 int main(int argc, char* argv[])
 {
     // parse args
-    mat_arg args = {3000, 3000, 3000, 50, 50, 10000};
+    mat_arg args = {3000, 3000, 3000, 50, 50, 10000, 0, 0, 0, 0};
     int res = parse_args(argc, argv, &args);
     if (res != EXIT_SUCCESS){
         return EXIT_FAILURE;
     }
 
-    fprintf(stdout, "Creating matrix A with rows = %d, cols = %d and B with rows = %d, cols = %d and max init value = %d" \
-        "\nUsing block size = (%d, %d) for blocked mm algorithm\n", args.m, args.n, args.n, args.q, args.max_float, args.row_split, args.col_split);
+#ifdef WITH_SERVICE
+    const char* socket_path = getenv("MATRIXMUL_SOCKET") != NULL ? getenv("MATRIXMUL_SOCKET") : SERVICE_DEFAULT_SOCKET;
+    if(args.daemon){
+        fprintf(stdout, "Serving multiplications on \"%s\" using block size = (%" PRId64 ", %" PRId64 ")\n", socket_path, args.row_split, args.col_split);
+        return service_run(socket_path, args.row_split, args.col_split);
+    }
+    if(args.clients > 0){
+        fprintf(stdout, "Sending %d rounds of %" PRId64 " concurrent jobs A (%" PRId64 " x %" PRId64 ") * B (%" PRId64 " x %" PRId64 ") to \"%s\"\n",
+            SERVICE_ROUNDS, args.clients, args.m, args.n, args.n, args.q, socket_path);
+        srand(DEV_SEED);
+        return service_client_benchmark(socket_path, args.m, args.n, args.q, (int) args.clients, SERVICE_ROUNDS);
+    }
+#endif
+
+    fprintf(stdout, "Creating matrix A with rows = %" PRId64 ", cols = %" PRId64 " and B with rows = %" PRId64 ", cols = %" PRId64 " and max init value = %" PRId64 \
+        "\nUsing block size = (%" PRId64 ", %" PRId64 ") for blocked mm algorithm\n", args.m, args.n, args.n, args.q, args.max_float, args.row_split, args.col_split);
 
     // create matrices
     matrix mat_A = create_matrix(args.m, args.n);
     matrix mat_B = create_matrix(args.n, args.q);
     matrix mat_C = create_matrix(args.m, args.q);
+    if(mat_A.data == NULL || mat_B.data == NULL || mat_C.data == NULL){
+        fprintf(stderr, "Cannot allocate the matrices.\n");
+        free_matrix(&mat_A);
+        free_matrix(&mat_B);
+        free_matrix(&mat_C);
+        return EXIT_FAILURE;
+    }
 
     // init rng seed
     srand(DEV_SEED);
@@ -61,6 +107,7 @@ int main(int argc, char* argv[])
     matrix_vanilla_mul(&mat_A, &mat_B, &mat_C);
     algorithm_time = omp_get_wtime() - algorithm_time;
     fprintf(stdout, "Took \"%04.2f\" ms\n", algorithm_time);
+    verify_result(&args, &mat_A, &mat_B, &mat_C);
 
     fprintf(stdout, "Starting calc with parallel vanilla omp algorithm:\n");
     memset(mat_C.data, 0, mat_C.cols * mat_C.rows * sizeof(float));
@@ -69,13 +116,16 @@ int main(int argc, char* argv[])
     matrix_vanilla_mul_omp(&mat_A, &mat_B, &mat_C);
     algorithm_time = omp_get_wtime() - algorithm_time;
     fprintf(stdout, "Took \"%04.2f\" ms\n", algorithm_time);
+    verify_result(&args, &mat_A, &mat_B, &mat_C);
 
     fprintf(stdout, "Starting calc with prepared blocked algorithm:\n");
+    memset(mat_C.data, 0, mat_C.cols * mat_C.rows * sizeof(float));
 
     algorithm_time = omp_get_wtime();
     matrix_block_mul(&mult_op);
     algorithm_time = omp_get_wtime() - algorithm_time;
     fprintf(stdout, "Took \"%04.2f\" ms\n", algorithm_time);
+    verify_result(&args, &mat_A, &mat_B, &mat_C);
 
     fprintf(stdout, "Starting calc with parallel prepared blocked omp algorithm:\n");
     memset(mat_C.data, 0, mat_C.cols * mat_C.rows * sizeof(float));
@@ -84,6 +134,7 @@ int main(int argc, char* argv[])
     matrix_block_mul_omp(&mult_op);
     algorithm_time = omp_get_wtime() - algorithm_time;
     fprintf(stdout, "Took \"%04.2f\" ms\n", algorithm_time);
+    verify_result(&args, &mat_A, &mat_B, &mat_C);
 
     fprintf(stdout, "Starting calc with parallel inline blocked omp algorithm:\n");
     memset(mat_C.data, 0, mat_C.cols * mat_C.rows * sizeof(float));
@@ -92,6 +143,69 @@ int main(int argc, char* argv[])
     matrix_block_mul_inline_omp(&mat_A, &mat_B, &mat_C, args.row_split, args.col_split);
     algorithm_time = omp_get_wtime() - algorithm_time;
     fprintf(stdout, "Took \"%04.2f\" ms\n", algorithm_time);
+    verify_result(&args, &mat_A, &mat_B, &mat_C);
+
+#ifdef WITH_SUMMA
+    if(args.procs > 0){
+        matrix mat_D = create_matrix(args.m, args.q);
+        double base_time = 0;
+        if(mat_D.data == NULL){
+            fprintf(stderr, "Cannot allocate the result of the distributed multiplication.\n");
+            res = EXIT_FAILURE;
+        }
+        // the threads per process stay the same for every process count, so the resources grow with it
+        int threads = omp_get_max_threads() / args.procs > 1 ? (int) (omp_get_max_threads() / args.procs) : 1;
+
+        // strong scaling: fixed problem size
+        fprintf(stdout, "Starting strong scaling of distributed SUMMA algorithm with %d threads per process:\n", threads);
+        for(int64_t p = 1; p <= args.procs && mat_D.data != NULL; p = (p < args.procs && 2 * p > args.procs) ? args.procs : 2 * p){
+            res = matrix_summa_mul_shm(&mat_A, &mat_B, &mat_D, args.row_split, args.col_split, (int) p, threads, &algorithm_time);
+            if(res != EXIT_SUCCESS){
+                fprintf(stderr, "Distributed multiplication with %" PRId64 " processes failed.\n", p);
+                break;
+            }
+            if(p == 1) base_time = algorithm_time;
+
+            float max_error = 0;
+            for(mat_index i = 0; i < mat_C.rows * mat_C.cols; i++){
+                max_error = fmaxf(max_error, fabsf(mat_C.data[i] - mat_D.data[i]));
+            }
+            fprintf(stdout, "Processes = %" PRId64 ": took \"%04.2f\" s, speedup = %.2f, efficiency = %.2f, max deviation = %g\n",
+                p, algorithm_time, base_time / algorithm_time, base_time / algorithm_time / p, max_error);
+            verify_result(&args, &mat_A, &mat_B, &mat_D);
+        }
+        free_matrix(&mat_D);
+
+        // weak scaling: rows of A grow with the number of processes
+        fprintf(stdout, "Starting weak scaling of distributed SUMMA algorithm with %d threads per process:\n", threads);
+        for(int64_t p = 1; p <= args.procs; p = (p < args.procs && 2 * p > args.procs) ? args.procs : 2 * p){
+            matrix mat_W = create_matrix(args.m > INT64_MAX / p ? -1 : args.m * p, args.n);
+            matrix mat_R = create_matrix(args.m > INT64_MAX / p ? -1 : args.m * p, args.q);
+            if(mat_W.data == NULL || mat_R.data == NULL){
+                fprintf(stderr, "Cannot allocate the matrices for %" PRId64 " processes.\n", p);
+                free_matrix(&mat_W);
+                free_matrix(&mat_R);
+                res = EXIT_FAILURE;
+                break;
+            }
+            matrix_random_init(&mat_W, 9.0);
+
+            res = matrix_summa_mul_shm(&mat_W, &mat_B, &mat_R, args.row_split, args.col_split, (int) p, threads, &algorithm_time);
+            if(res == EXIT_SUCCESS){
+                if(p == 1) base_time = algorithm_time;
+                fprintf(stdout, "Processes = %" PRId64 ", rows of A = %" PRId64 ": took \"%04.2f\" s, efficiency = %.2f\n",
+                    p, args.m * p, algorithm_time, base_time / algorithm_time);
+                verify_result(&args, &mat_W, &mat_B, &mat_R);
+            }
+            free_matrix(&mat_W);
+            free_matrix(&mat_R);
+            if(res != EXIT_SUCCESS){
+                fprintf(stderr, "Distributed multiplication with %" PRId64 " processes failed.\n", p);
+                break;
+            }
+        }
+    }
+#endif
 
     // Cleanup
     close_matrix_mult(&mult_op);
@@ -1,11 +1,14 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include <float.h>
 #include <omp.h>
 #include "matrix.h"
 
 #define RAND09() ( (((float) rand()) / (float) RAND_MAX) * 9)
 #define RAND(x) ( (((float) rand()) / (float) RAND_MAX) * x)
+// multiple of the expected rounding error accepted by matrix_freivalds_verify
+#define FREIVALDS_TOLERANCE 4
 
 /**
  * @brief Prepare a block-wise matrix multiplication by partitioning the input matrices into blocks of
@@ -20,15 +23,15 @@
  * @param mult_op 
  * @return int 
  */
-int prepare_matrix_block_mult(matrix* A, matrix* B, matrix* C, int row_split, int col_split, matrix_mult_operation* mult_op){
+int prepare_matrix_block_mult(matrix* A, matrix* B, matrix* C, mat_index row_split, mat_index col_split, matrix_mult_operation* mult_op){
     // check if mul is compatible
     if(A->cols != B->rows || C->rows != A->rows || C->cols != B->cols) return EXIT_FAILURE;
 
     // because col count in A equals row count in B we can subdivide both matrices equally along row in A and along col in B
-    int split_A_cols = A->cols / col_split + (A->cols % col_split);
-    int split_A_rows = A->rows / row_split + (A->rows % row_split);
-    int split_B_cols = B->cols / row_split + (B->cols % row_split);
-    int split_B_rows = split_A_cols;
+    mat_index split_A_cols = A->cols / col_split + (A->cols % col_split);
+    mat_index split_A_rows = A->rows / row_split + (A->rows % row_split);
+    mat_index split_B_cols = B->cols / row_split + (B->cols % row_split);
+    mat_index split_B_rows = split_A_cols;
 
     // create arrays which hold submatrices
     sub_matrix_meta* meta_A_list = malloc(sizeof(sub_matrix_meta) * (split_A_rows * split_A_cols));
@@ -43,24 +46,24 @@ int prepare_matrix_block_mult(matrix* A, matrix* B, matrix* C, int row_split, in
 
     // iterate over submatrix arrays and fill indices
     // A
-    for(int i = 0; i < split_A_rows; i++){
-        for(int j = 0; j < split_A_cols; j++){
+    for(mat_index i = 0; i < split_A_rows; i++){
+        for(mat_index j = 0; j < split_A_cols; j++){
             sub_matrix_meta* p = &meta_A_list[MIDX(i, j, split_A_cols)];
             p->col_start = j * col_split;
-            p->col_end = fminl(p->col_start + col_split,  A->cols);
+            p->col_end = MIN(p->col_start + col_split,  A->cols);
             p->row_start = i * row_split;
-            p->row_end = fminl(p->row_start + row_split, A->rows);
+            p->row_end = MIN(p->row_start + row_split, A->rows);
         }
     }
     // B
-    for(int i = 0; i < split_B_rows; i++){
-        for(int j = 0; j < split_B_cols; j++){
+    for(mat_index i = 0; i < split_B_rows; i++){
+        for(mat_index j = 0; j < split_B_cols; j++){
             sub_matrix_meta* p = &meta_B_list[MIDX(i, j, split_B_cols)];
             p->col_start = j * row_split;
-            p->col_end = fminl(p->col_start + row_split,  B->cols);
+            p->col_end = MIN(p->col_start + row_split,  B->cols);
             // B uses col_split for its rows because it has to match A's columns
             p->row_start = i * col_split;
-            p->row_end = fminl(p->row_start + col_split, B->rows);
+            p->row_end = MIN(p->row_start + col_split, B->rows);
         }
     }
 
@@ -85,9 +88,9 @@ int prepare_matrix_block_mult(matrix* A, matrix* B, matrix* C, int row_split, in
  */
 void matrix_block_mul_omp(matrix_mult_operation* mult_op){
     #pragma omp parallel for
-    for(int u = 0; u < mult_op->split_A.rows; u++){
-        for(int v = 0; v < mult_op->split_B.cols; v++){
-            for(int c = 0; c < mult_op->split_A.cols; c++){
+    for(mat_index u = 0; u < mult_op->split_A.rows; u++){
+        for(mat_index v = 0; v < mult_op->split_B.cols; v++){
+            for(mat_index c = 0; c < mult_op->split_A.cols; c++){
                 sub_matrix_mul(mult_op, &mult_op->split_A.data[MIDX(u, c, mult_op->split_A.cols)], &mult_op->split_B.data[MIDX(c, v, mult_op->split_B.cols)]);
             }
         }
@@ -101,9 +104,9 @@ void matrix_block_mul_omp(matrix_mult_operation* mult_op){
  * @param mult_op 
  */
 void matrix_block_mul(matrix_mult_operation* mult_op){
-    for(int u = 0; u < mult_op->split_A.rows; u++){
-        for(int v = 0; v < mult_op->split_B.cols; v++){
-            for(int c = 0; c < mult_op->split_A.cols; c++){
+    for(mat_index u = 0; u < mult_op->split_A.rows; u++){
+        for(mat_index v = 0; v < mult_op->split_B.cols; v++){
+            for(mat_index c = 0; c < mult_op->split_A.cols; c++){
                 sub_matrix_mul(mult_op, &mult_op->split_A.data[MIDX(u, c, mult_op->split_A.cols)], &mult_op->split_B.data[MIDX(c, v, mult_op->split_B.cols)]);
             }
         }
@@ -119,10 +122,10 @@ void matrix_block_mul(matrix_mult_operation* mult_op){
  * @param B 
  */
 void sub_matrix_mul(matrix_mult_operation* mul_op, sub_matrix_meta* A, sub_matrix_meta* B){
-    for(int i = A->row_start; i < A->row_end; i++){
-        for(int j = B->col_start; j < B->col_end; j++){
+    for(mat_index i = A->row_start; i < A->row_end; i++){
+        for(mat_index j = B->col_start; j < B->col_end; j++){
             float acc = mul_op->mat_C->data[MIDX(i, j, mul_op->mat_C->cols)];
-            for(int k = A->col_start; k < A->col_end; k++){
+            for(mat_index k = A->col_start; k < A->col_end; k++){
                 float val_left = mul_op->mat_A->data[MIDX(i, k, mul_op->mat_A->cols)];
                 float val_right = mul_op->mat_B->data[MIDX(k, j, mul_op->mat_B->cols)]; 
                 acc += val_left * val_right;
@@ -144,20 +147,20 @@ void sub_matrix_mul(matrix_mult_operation* mul_op, sub_matrix_meta* A, sub_matri
  * @param col_split 
  * @return int 
  */
-int matrix_block_mul_inline_omp(matrix* A, matrix* B, matrix* C, int row_split, int col_split){
+int matrix_block_mul_inline_omp(matrix* A, matrix* B, matrix* C, mat_index row_split, mat_index col_split){
     if(A->cols != B->rows) return EXIT_FAILURE;
 
     // The following three loops are iterating over the block matrices
     #pragma omp parallel for
-    for(int i_ = 0; i_ < A->rows; i_ += row_split){
+    for(mat_index i_ = 0; i_ < A->rows; i_ += row_split){
         // Note: we are going in row_split steps along the columns of B because the split along rows of A has to be equal to the split along columns of B
-        for(int j_ = 0; j_ < B->cols; j_ += row_split){
-            for(int k_ = 0; k_ < A->cols; k_ += col_split){
+        for(mat_index j_ = 0; j_ < B->cols; j_ += row_split){
+            for(mat_index k_ = 0; k_ < A->cols; k_ += col_split){
                 // The remaining loops are for the regular matrix multiplication with the exception to minor changes due to block matrix multiplication
-                for(int i = i_; i < fminl(i_ + row_split, A->rows); i++){
-                    for(int j = j_; j < fminl(j_ + row_split, B->cols); j++){
+                for(mat_index i = i_; i < MIN(i_ + row_split, A->rows); i++){
+                    for(mat_index j = j_; j < MIN(j_ + row_split, B->cols); j++){
                         float acc = C->data[MIDX(i, j, C->cols)];
-                        for(int k = k_; k < fminl(k_ + col_split, A->cols); k++){
+                        for(mat_index k = k_; k < MIN(k_ + col_split, A->cols); k++){
                             acc += A->data[MIDX(i, k, A->cols)] * B->data[MIDX(k, j, B->cols)];
                         }
                         C->data[MIDX(i, j, C->cols)] = acc;
@@ -181,10 +184,10 @@ int matrix_block_mul_inline_omp(matrix* A, matrix* B, matrix* C, int row_split,
 int matrix_vanilla_mul(matrix* A, matrix* B, matrix* C){
     if(A->cols != B->rows) return EXIT_FAILURE;
 
-    for(int i = 0; i < A->rows; i++){
-        for(int j = 0; j < B->cols; j++){
+    for(mat_index i = 0; i < A->rows; i++){
+        for(mat_index j = 0; j < B->cols; j++){
             float acc = C->data[MIDX(i, j, C->cols)];
-            for(int k = 0; k < A->cols; k++){
+            for(mat_index k = 0; k < A->cols; k++){
                 acc += A->data[MIDX(i, k, A->cols)] * B->data[MIDX(k, j, B->cols)];
             }
             C->data[MIDX(i, j, C->cols)] = acc;
@@ -210,10 +213,10 @@ int matrix_vanilla_mul_omp(matrix* A, matrix* B, matrix* C){
     if(A->cols != B->rows) return EXIT_FAILURE;
 
     #pragma omp parallel for
-    for(int i = 0; i < A->rows; i++){
-        for(int j = 0; j < B->cols; j++){
+    for(mat_index i = 0; i < A->rows; i++){
+        for(mat_index j = 0; j < B->cols; j++){
             float dot = 0;
-            for(int k = 0; k < A->cols; k++){
+            for(mat_index k = 0; k < A->cols; k++){
                 dot += A->data[MIDX(i, k, A->cols)] * B->data[MIDX(k, j, B->cols)];
             }
             C->data[MIDX(i, j, C->cols)] = dot;
@@ -223,18 +226,87 @@ int matrix_vanilla_mul_omp(matrix* A, matrix* B, matrix* C){
     return EXIT_SUCCESS;
 }
 
+/**
+ * @brief Verify that C = A * B with Freivalds' algorithm which only needs O(n^2) operations per round.
+ * For a random vector r with entries of +1 and -1 the result A * (B * r) has to match C * r.
+ * Because C was computed in float, its elements deviate by about sqrt(n) * eps * (|A| * |B|)_ij in practice
+ * (the worst case bound n * eps would hide whole wrong elements of large matrices). Summed up with random
+ * signs these errors grow like the 2-norm of row i of |A| * |B|, which is bounded by sum_k |A_ik| * ||B_k||_2.
+ * So row i may deviate by FREIVALDS_TOLERANCE * sqrt(n) * eps * sum_k |A_ik| * ||B_k||_2, which grows with
+ * sqrt(q) and not with q. The checks themselves are done in double.
+ * An element of C which is off by more than the tolerance of its row is detected in a round with
+ * probability of at least 1/2, smaller errors may pass. Uses rand() for the random vectors.
+ * 
+ * @param A 
+ * @param B 
+ * @param C 
+ * @param rounds number of random vectors
+ * @return int EXIT_SUCCESS if C passed every round
+ */
+int matrix_freivalds_verify(matrix* A, matrix* B, matrix* C, int rounds){
+    if(A->cols != B->rows || C->rows != A->rows || C->cols != B->cols) return EXIT_FAILURE;
+
+    double* r = malloc(sizeof(double) * B->cols);
+    double* br = malloc(sizeof(double) * B->rows);
+    double* b_norm = malloc(sizeof(double) * B->rows);
+    int res = EXIT_SUCCESS;
+
+    for(int round = 0; round < rounds && res == EXIT_SUCCESS; round++){
+        for(mat_index j = 0; j < B->cols; j++){
+            r[j] = rand() % 2 ? 1.0 : -1.0;
+        }
+
+        // B * r and the 2-norms of the rows of B
+        #pragma omp parallel for
+        for(mat_index k = 0; k < B->rows; k++){
+            double acc = 0, acc_sq = 0;
+            for(mat_index j = 0; j < B->cols; j++){
+                double val = B->data[MIDX(k, j, B->cols)];
+                acc += val * r[j];
+                acc_sq += val * val;
+            }
+            br[k] = acc;
+            b_norm[k] = sqrt(acc_sq);
+        }
+
+        // compare A * (B * r) with C * r row by row
+        #pragma omp parallel for reduction(|:res)
+        for(mat_index i = 0; i < A->rows; i++){
+            double abr = 0, bound = 0, cr = 0;
+            for(mat_index k = 0; k < A->cols; k++){
+                double val = A->data[MIDX(i, k, A->cols)];
+                abr += val * br[k];
+                bound += fabs(val) * b_norm[k];
+            }
+            for(mat_index j = 0; j < C->cols; j++){
+                cr += C->data[MIDX(i, j, C->cols)] * r[j];
+            }
+            // written as negation to fail on NaN
+            if(!(fabs(abr - cr) <= FREIVALDS_TOLERANCE * sqrt((double) A->cols) * FLT_EPSILON * bound)) res |= EXIT_FAILURE;
+        }
+    }
+
+    free(r);
+    free(br);
+    free(b_norm);
+
+    return res;
+}
+
 /**
  * @brief Create a matrix object and allocate memory for the float array
  * 
  * @param rows 
  * @param cols 
- * @return matrix 
+ * @return matrix data is NULL if the size does not fit into size_t or the allocation failed
  */
-matrix create_matrix(long rows, long cols){
+matrix create_matrix(mat_index rows, mat_index cols){
     matrix mat;
     mat.cols = cols;
     mat.rows = rows;
-    mat.data = malloc(sizeof(float) * (rows * cols));
+    mat.data = NULL;
+    if(rows < 0 || cols < 0 || (rows > 0 && (uint64_t) cols > SIZE_MAX / sizeof(float) / (uint64_t) rows)) return mat;
+    mat.data = malloc(sizeof(float) * (size_t) (rows * cols));
 
     return mat;
 }
@@ -265,7 +337,7 @@ void free_matrix(matrix* mat){
  * @param mat 
  */
 void matrix_random_init(matrix* mat, float max){
-    for(int i = 0; i < mat->rows * mat->cols; i++){
+    for(mat_index i = 0; i < mat->rows * mat->cols; i++){
         float rnd = RAND(max);
         //fprintf(stdout, "Generating random number: %1.2f\n", rnd);
         mat->data[i] = rnd;
@@ -278,7 +350,7 @@ void matrix_random_init(matrix* mat, float max){
  * @param mat 
  */
 void matrix_simple_init(matrix* mat){
-    for(int i = 0; i < mat->rows * mat->cols; i++){
+    for(mat_index i = 0; i < mat->rows * mat->cols; i++){
         mat->data[i] = (float)i;
     }
 }
\ No newline at end of file
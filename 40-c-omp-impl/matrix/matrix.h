@@ -1,25 +1,33 @@
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <stdint.h>
+
+// all sizes and indices are 64 bit wide, also where long is not
+typedef int64_t mat_index;
+
 typedef struct matrix{
-    long rows;
-    long cols;
+    mat_index rows;
+    mat_index cols;
     float *data;
 } matrix;
 
 typedef struct sub_matrix_meta{
-    long row_start;
-    long row_end;
-    long col_start;
-    long col_end;
+    mat_index row_start;
+    mat_index row_end;
+    mat_index col_start;
+    mat_index col_end;
 } sub_matrix_meta;
 
 typedef struct split_matrix{
-    long rows;
-    long cols;
+    mat_index rows;
+    mat_index cols;
     sub_matrix_meta* data;
 } split_matrix;
 
 typedef struct sub_matrix_dimensions{
-    long rows;
-    long cols;
+    mat_index rows;
+    mat_index cols;
 } sub_matrix_dimensions;
 
 typedef struct matrix_mult_operation{
@@ -30,18 +38,25 @@ typedef struct matrix_mult_operation{
     split_matrix split_B;
 } matrix_mult_operation;
 
-matrix create_matrix(long rows, long cols);
+matrix create_matrix(mat_index rows, mat_index cols);
 void free_matrix(matrix* mat);
 void matrix_random_init(matrix* mat, float max);
-int prepare_matrix_block_mult(matrix* A, matrix* B, matrix* C, int row_split, int col_split, matrix_mult_operation* mult_op);
+int prepare_matrix_block_mult(matrix* A, matrix* B, matrix* C, mat_index row_split, mat_index col_split, matrix_mult_operation* mult_op);
 void close_matrix_mult(matrix_mult_operation* mult_op);
 void sub_matrix_mul(matrix_mult_operation* mul_op, sub_matrix_meta* A, sub_matrix_meta* B);
 void matrix_simple_init(matrix* mat);
 void matrix_block_mul_omp(matrix_mult_operation* mult_op);
 int matrix_vanilla_mul(matrix* A, matrix* B, matrix* C);
-int matrix_block_mul_inline_omp(matrix* A, matrix* B, matrix* C, int row_split, int col_split);
+int matrix_block_mul_inline_omp(matrix* A, matrix* B, matrix* C, mat_index row_split, mat_index col_split);
 int matrix_vanilla_mul_omp(matrix* A, matrix* B, matrix* C);
 void matrix_block_mul(matrix_mult_operation* mult_op);
+int matrix_freivalds_verify(matrix* A, matrix* B, matrix* C, int rounds);
 
 // matrix operations
-#define MIDX(r, c, w) (w * r + c)
\ No newline at end of file
+#define MIDX(r, c, w) ((w) * (r) + (c))
+// integer minimum, fminl is not exact for 64-bit indices on every platform
+#ifndef MIN
+#define MIN(a, b) ( (a) < (b) ? (a) : (b) )
+#endif
+
+#endif
\ No newline at end of file
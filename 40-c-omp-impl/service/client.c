@@ -0,0 +1,273 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <omp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "service.h"
+
+/**
+ * @brief Connect to the multiplication service
+ *
+ * @param path
+ * @return int socket or -1 on failure
+ */
+int service_connect(const char* path){
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(strlen(path) >= sizeof(addr.sun_path)) return -1;
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if(fd < 0) return -1;
+    if(connect(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0){
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static int service_send_request(int fd, int op, long id, const service_operands* operands){
+    service_request req;
+    memset(&req, 0, sizeof(req));
+    req.op = op;
+    req.id = id;
+    if(operands != NULL){
+        req.m = operands->A.rows;
+        req.n = operands->A.cols;
+        req.q = operands->B.cols;
+        snprintf(req.shm_name, sizeof(req.shm_name), "%s", operands->name);
+    }
+
+    return send(fd, &req, sizeof(req), MSG_NOSIGNAL) == sizeof(req) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Submit a multiplication of the given operands without waiting for the result.
+ * Several jobs can be in flight on one connection, their replies carry the given id.
+ *
+ * @param fd
+ * @param id
+ * @param operands
+ * @return int
+ */
+int service_submit(int fd, long id, const service_operands* operands){
+    return service_send_request(fd, SERVICE_OP_MULTIPLY, id, operands);
+}
+
+/**
+ * @brief Wait for the next reply on the given connection
+ *
+ * @param fd
+ * @param reply
+ * @return int
+ */
+int service_receive(int fd, service_reply* reply){
+    return recv(fd, reply, sizeof(service_reply), 0) == sizeof(service_reply) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Query the latency statistics of the service. There must not be any jobs in flight
+ * on the given connection.
+ *
+ * @param fd
+ * @param stats
+ * @return int
+ */
+int service_get_stats(int fd, service_stats* stats){
+    service_reply reply;
+    if(service_send_request(fd, SERVICE_OP_STATS, 0, NULL) != EXIT_SUCCESS || service_receive(fd, &reply) != EXIT_SUCCESS) return EXIT_FAILURE;
+    *stats = reply.stats;
+    return reply.status;
+}
+
+/**
+ * @brief Ask the service to stop after answering the jobs it already received
+ *
+ * @param fd
+ * @return int
+ */
+int service_shutdown(int fd){
+    service_reply reply;
+    if(service_send_request(fd, SERVICE_OP_SHUTDOWN, 0, NULL) != EXIT_SUCCESS || service_receive(fd, &reply) != EXIT_SUCCESS) return EXIT_FAILURE;
+    return reply.status;
+}
+
+/**
+ * @brief Calculate the size of a shared memory object holding A (m x n), B (n x q) and C (m x q)
+ *
+ * @param m
+ * @param n
+ * @param q
+ * @param length
+ * @return int EXIT_FAILURE if a dimension is not positive or the size does not fit into size_t
+ */
+int service_operands_length(mat_index m, mat_index n, mat_index q, size_t* length){
+    if(m < 1 || n < 1 || q < 1) return EXIT_FAILURE;
+
+    const uint64_t limit = SIZE_MAX / sizeof(float);
+    uint64_t um = m, un = n, uq = q;
+    if(um > limit || un > limit || uq > limit) return EXIT_FAILURE;
+    if(um > limit / un || un > limit / uq || um > limit / uq) return EXIT_FAILURE;
+
+    uint64_t elements = um * un;
+    if(un * uq > limit - elements) return EXIT_FAILURE;
+    elements += un * uq;
+    if(um * uq > limit - elements) return EXIT_FAILURE;
+    elements += um * uq;
+
+    *length = sizeof(float) * (size_t) elements;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Create a shared memory object holding A (m x n), B (n x q) and C (m x q)
+ * which can be handed to the service
+ *
+ * @param operands
+ * @param name name of the shared memory object, has to start with a slash
+ * @param m
+ * @param n
+ * @param q
+ * @return int
+ */
+int service_operands_create(service_operands* operands, const char* name, mat_index m, mat_index n, mat_index q){
+    if(strlen(name) >= SERVICE_NAME_LEN) return EXIT_FAILURE;
+    if(service_operands_length(m, n, q, &operands->length) != EXIT_SUCCESS) return EXIT_FAILURE;
+    strcpy(operands->name, name);
+
+    int fd = shm_open(name, O_CREAT | O_TRUNC | O_RDWR, 0600);
+    if(fd < 0) return EXIT_FAILURE;
+    if(ftruncate(fd, operands->length) != 0){
+        close(fd);
+        shm_unlink(name);
+        return EXIT_FAILURE;
+    }
+    operands->base = mmap(NULL, operands->length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(operands->base == MAP_FAILED){
+        shm_unlink(name);
+        return EXIT_FAILURE;
+    }
+
+    operands->A = (matrix) {m, n, operands->base};
+    operands->B = (matrix) {n, q, operands->base + m * n};
+    operands->C = (matrix) {m, q, operands->base + m * n + n * q};
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Unmap and remove the shared memory object of the operands
+ *
+ * @param operands
+ */
+void service_operands_close(service_operands* operands){
+    munmap(operands->base, operands->length);
+    shm_unlink(operands->name);
+    operands->base = NULL;
+}
+
+/**
+ * @brief Send rounds of concurrent multiplication jobs from several connections to the
+ * service and print the latency seen by the clients and by the service.
+ *
+ * @param path
+ * @param m
+ * @param n
+ * @param q
+ * @param clients number of connections, each one has a job in flight per round
+ * @param rounds
+ * @return int
+ */
+int service_client_benchmark(const char* path, mat_index m, mat_index n, mat_index q, int clients, int rounds){
+    int res = EXIT_SUCCESS;
+    int* fds = malloc(sizeof(int) * clients);
+    struct pollfd* pfds = malloc(sizeof(struct pollfd) * clients);
+    service_operands* operands = malloc(sizeof(service_operands) * clients);
+    double* submitted = malloc(sizeof(double) * clients);
+    double* samples = malloc(sizeof(double) * clients * rounds);
+    long count = 0;
+
+    int opened = 0;
+    for(; opened < clients; opened++){
+        char name[SERVICE_NAME_LEN];
+        snprintf(name, sizeof(name), "/matrixmul-job-%ld-%d", (long) getpid(), opened);
+        if(service_operands_create(&operands[opened], name, m, n, q) != EXIT_SUCCESS) break;
+        fds[opened] = service_connect(path);
+        if(fds[opened] < 0){
+            service_operands_close(&operands[opened]);
+            break;
+        }
+        matrix_random_init(&operands[opened].A, 9.0);
+        matrix_random_init(&operands[opened].B, 9.0);
+        pfds[opened].fd = fds[opened];
+        pfds[opened].events = POLLIN;
+    }
+    if(opened < clients){
+        fprintf(stderr, "Cannot connect to the service at %s\n", path);
+        res = EXIT_FAILURE;
+    }
+
+    double algorithm_time = omp_get_wtime();
+    for(int r = 0; r < rounds && res == EXIT_SUCCESS; r++){
+        for(int c = 0; c < clients && res == EXIT_SUCCESS; c++){
+            submitted[c] = omp_get_wtime();
+            res = service_submit(fds[c], (long) r * clients + c, &operands[c]);
+        }
+
+        // collect the replies in the order they arrive
+        int pending = res == EXIT_SUCCESS ? clients : 0;
+        while(pending > 0 && res == EXIT_SUCCESS){
+            if(poll(pfds, clients, -1) < 0){
+                res = EXIT_FAILURE;
+                break;
+            }
+            for(int c = 0; c < clients; c++){
+                if(pfds[c].revents == 0) continue;
+                service_reply reply;
+                if(service_receive(fds[c], &reply) != EXIT_SUCCESS || reply.status != EXIT_SUCCESS){
+                    res = EXIT_FAILURE;
+                    break;
+                }
+                samples[count++] = omp_get_wtime() - submitted[c];
+                pending--;
+            }
+        }
+    }
+    algorithm_time = omp_get_wtime() - algorithm_time;
+
+    if(res == EXIT_SUCCESS){
+        service_stats stats;
+        service_percentiles(samples, count, &stats);
+        fprintf(stdout, "Client: %ld requests took \"%04.2f\" s (%.0f requests/s), latency p50 = %.1f us, p90 = %.1f us, p99 = %.1f us, max = %.1f us\n",
+            count, algorithm_time, count / algorithm_time, stats.p50 * 1e6, stats.p90 * 1e6, stats.p99 * 1e6, stats.max * 1e6);
+
+        res = service_get_stats(fds[0], &stats);
+        if(res == EXIT_SUCCESS){
+            fprintf(stdout, "Service: %ld requests in %ld batches, latency p50 = %.1f us, p90 = %.1f us, p99 = %.1f us, max = %.1f us\n",
+                stats.count, stats.batches, stats.p50 * 1e6, stats.p90 * 1e6, stats.p99 * 1e6, stats.max * 1e6);
+        }
+    } else if(opened == clients){
+        fprintf(stderr, "Multiplication job failed\n");
+    }
+
+    for(int c = 0; c < opened; c++){
+        close(fds[c]);
+        service_operands_close(&operands[c]);
+    }
+    free(fds);
+    free(pfds);
+    free(operands);
+    free(submitted);
+    free(samples);
+
+    return res;
+}
\ No newline at end of file
@@ -0,0 +1,445 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <omp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "service.h"
+
+/**
+ * @brief Operands of a client which stay mapped while the connection is open
+ */
+typedef struct service_mapping{
+    char name[SERVICE_NAME_LEN];
+    size_t length;
+    float* base;
+    // jobs of the current batch using the mapping
+    int in_use;
+} service_mapping;
+
+typedef struct service_client{
+    service_mapping mappings[SERVICE_MAX_MAPPINGS];
+    int next;
+} service_client;
+
+typedef struct service_job{
+    int fd;
+    service_request req;
+    double received;
+    int status;
+    float* base;
+    size_t length;
+    // NULL if the operands are mapped for this job only
+    service_mapping* mapping;
+    matrix A;
+    matrix B;
+    matrix C;
+} service_job;
+
+/**
+ * @brief Everything the service needs while running. Allocated once on startup so that
+ * serving a request does not allocate.
+ */
+typedef struct service_state{
+    int running;
+    mat_index row_split;
+    mat_index col_split;
+    struct pollfd fds[SERVICE_MAX_CLIENTS + 1];
+    // same index as fds
+    service_client clients[SERVICE_MAX_CLIENTS + 1];
+    int nfds;
+    int closed;
+    service_job jobs[SERVICE_MAX_BATCH];
+    int njobs;
+    long count;
+    long batches;
+    double samples[SERVICE_MAX_SAMPLES];
+    double sorted[SERVICE_MAX_SAMPLES];
+    // signal mask while waiting, SIGINT and SIGTERM are only delivered inside ppoll
+    sigset_t poll_mask;
+} service_state;
+
+static volatile sig_atomic_t service_stop = 0;
+
+static void service_signal(int sig){
+    (void) sig;
+    service_stop = 1;
+}
+
+static int compare_double(const void* a, const void* b){
+    double x = *(const double*) a, y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Sort the given latency samples in place and calculate percentiles
+ *
+ * @param samples
+ * @param n
+ * @param stats count and batches are left untouched
+ */
+void service_percentiles(double* samples, long n, service_stats* stats){
+    stats->p50 = stats->p90 = stats->p99 = stats->max = 0;
+    if(n <= 0) return;
+
+    qsort(samples, n, sizeof(double), compare_double);
+    stats->p50 = samples[(long) (0.50 * (n - 1))];
+    stats->p90 = samples[(long) (0.90 * (n - 1))];
+    stats->p99 = samples[(long) (0.99 * (n - 1))];
+    stats->max = samples[n - 1];
+}
+
+static void service_get_state_stats(service_state* s, service_stats* stats){
+    long n = s->count < SERVICE_MAX_SAMPLES ? s->count : SERVICE_MAX_SAMPLES;
+    memcpy(s->sorted, s->samples, sizeof(double) * n);
+    stats->count = s->count;
+    stats->batches = s->batches;
+    service_percentiles(s->sorted, n, stats);
+}
+
+static void service_send(int fd, long id, int status, double latency, service_stats* stats){
+    service_reply reply;
+    memset(&reply, 0, sizeof(reply));
+    reply.id = id;
+    reply.status = status;
+    reply.latency = latency;
+    if(stats != NULL) reply.stats = *stats;
+    // a client which went away is noticed by poll
+    send(fd, &reply, sizeof(reply), MSG_NOSIGNAL);
+}
+
+/**
+ * @brief Unmap all cached operands of a client
+ *
+ * @param client
+ */
+static void service_release_client(service_client* client){
+    for(int i = 0; i < SERVICE_MAX_MAPPINGS; i++){
+        if(client->mappings[i].base != NULL) munmap(client->mappings[i].base, client->mappings[i].length);
+    }
+    memset(client, 0, sizeof(service_client));
+}
+
+/**
+ * @brief Map the operands of a multiplication job. The mapping is cached for the connection
+ * by name and size, so repeated jobs on the same operands neither map nor unmap. If every
+ * cached mapping is used by the current batch the operands are mapped for this job only.
+ *
+ * @param client
+ * @param job
+ * @return int
+ */
+static int service_map_job(service_client* client, service_job* job){
+    service_request* req = &job->req;
+    req->shm_name[SERVICE_NAME_LEN - 1] = '\0';
+    size_t length;
+    if(service_operands_length(req->m, req->n, req->q, &length) != EXIT_SUCCESS) return EXIT_FAILURE;
+    // the products of two sizes fit, so the amount of work can be checked without overflowing
+    if(req->m * req->n > SERVICE_MAX_WORK / req->q) return EXIT_FAILURE;
+
+    job->mapping = NULL;
+    for(int i = 0; i < SERVICE_MAX_MAPPINGS && job->mapping == NULL; i++){
+        service_mapping* m = &client->mappings[i];
+        if(m->base != NULL && m->length == length && strcmp(m->name, req->shm_name) == 0) job->mapping = m;
+    }
+
+    if(job->mapping != NULL){
+        job->base = job->mapping->base;
+    } else {
+        int fd = shm_open(req->shm_name, O_RDWR, 0);
+        if(fd < 0) return EXIT_FAILURE;
+
+        struct stat st;
+        if(fstat(fd, &st) != 0 || (size_t) st.st_size < length){
+            close(fd);
+            return EXIT_FAILURE;
+        }
+        job->base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if(job->base == MAP_FAILED) return EXIT_FAILURE;
+
+        // replace the next mapping which is not used by the current batch
+        for(int i = 0; i < SERVICE_MAX_MAPPINGS && job->mapping == NULL; i++){
+            service_mapping* m = &client->mappings[(client->next + i) % SERVICE_MAX_MAPPINGS];
+            if(m->in_use > 0) continue;
+            if(m->base != NULL) munmap(m->base, m->length);
+            strcpy(m->name, req->shm_name);
+            m->length = length;
+            m->base = job->base;
+            job->mapping = m;
+            client->next = (client->next + i + 1) % SERVICE_MAX_MAPPINGS;
+        }
+    }
+    if(job->mapping != NULL) job->mapping->in_use++;
+
+    job->length = length;
+    job->A = (matrix) {req->m, req->n, job->base};
+    job->B = (matrix) {req->n, req->q, job->base + req->m * req->n};
+    job->C = (matrix) {req->m, req->q, job->base + req->m * req->n + req->n * req->q};
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Handle a single message of a client. Multiplications are added to the current batch,
+ * everything else is answered right away.
+ *
+ * @param s
+ * @param index index of the connection in fds
+ * @param req
+ */
+static void service_handle(service_state* s, int index, service_request* req){
+    service_stats stats;
+    int fd = s->fds[index].fd;
+
+    switch(req->op){
+        case SERVICE_OP_MULTIPLY: {
+            service_job* job = &s->jobs[s->njobs];
+            job->fd = fd;
+            job->req = *req;
+            job->received = omp_get_wtime();
+            job->status = EXIT_SUCCESS;
+            if(service_map_job(&s->clients[index], job) != EXIT_SUCCESS){
+                service_send(fd, req->id, EXIT_FAILURE, 0, NULL);
+                return;
+            }
+            s->njobs++;
+            break;
+        }
+        case SERVICE_OP_STATS:
+            service_get_state_stats(s, &stats);
+            service_send(fd, req->id, EXIT_SUCCESS, 0, &stats);
+            break;
+        case SERVICE_OP_SHUTDOWN:
+            s->running = 0;
+            service_send(fd, req->id, EXIT_SUCCESS, 0, NULL);
+            break;
+        default:
+            service_send(fd, req->id, EXIT_FAILURE, 0, NULL);
+    }
+}
+
+/**
+ * @brief Wait up to timeout for new connections and requests and collect them.
+ *
+ * @param s
+ * @param timeout NULL to block
+ */
+static void service_poll(service_state* s, const struct timespec* timeout){
+    // interrupted by SIGINT or SIGTERM
+    if(ppoll(s->fds, s->nfds, timeout, &s->poll_mask) <= 0) return;
+
+    // new clients
+    if(s->fds[0].revents & POLLIN){
+        int fd = accept(s->fds[0].fd, NULL, NULL);
+        if(fd >= 0 && s->nfds <= SERVICE_MAX_CLIENTS){
+            s->fds[s->nfds].fd = fd;
+            s->fds[s->nfds].events = POLLIN;
+            s->fds[s->nfds].revents = 0;
+            memset(&s->clients[s->nfds], 0, sizeof(service_client));
+            s->nfds++;
+        } else if(fd >= 0){
+            close(fd);
+        }
+    }
+
+    for(int i = 1; i < s->nfds && s->njobs < SERVICE_MAX_BATCH; i++){
+        if(s->fds[i].fd < 0 || s->fds[i].revents == 0) continue;
+
+        // drain everything the client has sent so far
+        while(s->njobs < SERVICE_MAX_BATCH){
+            service_request req;
+            ssize_t n = recv(s->fds[i].fd, &req, sizeof(req), MSG_DONTWAIT);
+            if(n == sizeof(req)){
+                service_handle(s, i, &req);
+                continue;
+            }
+            if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) break;
+            // hang up or malformed message, closed once the current batch is answered
+            s->fds[i].fd = -s->fds[i].fd - 1;
+            s->closed = 1;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Only valid for jobs accepted by service_map_job, which limits the amount of work
+ *
+ * @param job
+ * @return int
+ */
+static int service_is_small(service_job* job){
+    return job->req.m * job->req.n * job->req.q <= SERVICE_SMALL_JOB;
+}
+
+/**
+ * @brief Run all jobs of the current batch. Small jobs are coalesced into a single parallel
+ * region with one job per thread, larger jobs get the whole thread team each.
+ *
+ * @param s
+ */
+static void service_execute(service_state* s){
+    int small = 0;
+    for(int i = 0; i < s->njobs; i++){
+        small += service_is_small(&s->jobs[i]);
+    }
+
+    if(small > 1){
+        // the nested parallel region of the kernel runs on the calling thread only
+        #pragma omp parallel for schedule(dynamic, 1)
+        for(int i = 0; i < s->njobs; i++){
+            service_job* job = &s->jobs[i];
+            if(!service_is_small(job)) continue;
+            memset(job->C.data, 0, sizeof(float) * job->C.rows * job->C.cols);
+            job->status = matrix_block_mul_inline_omp(&job->A, &job->B, &job->C, s->row_split, s->col_split);
+        }
+    }
+
+    for(int i = 0; i < s->njobs; i++){
+        service_job* job = &s->jobs[i];
+        if(small > 1 && service_is_small(job)) continue;
+        memset(job->C.data, 0, sizeof(float) * job->C.rows * job->C.cols);
+        job->status = matrix_block_mul_inline_omp(&job->A, &job->B, &job->C, s->row_split, s->col_split);
+    }
+
+    s->batches++;
+}
+
+/**
+ * @brief Answer and release all jobs of the current batch and record their latency
+ *
+ * @param s
+ */
+static void service_finish(service_state* s){
+    for(int i = 0; i < s->njobs; i++){
+        service_job* job = &s->jobs[i];
+        if(job->mapping != NULL) job->mapping->in_use--;
+        else munmap(job->base, job->length);
+
+        double latency = omp_get_wtime() - job->received;
+        s->samples[s->count % SERVICE_MAX_SAMPLES] = latency;
+        s->count++;
+        service_send(job->fd, job->req.id, job->status, latency, NULL);
+    }
+    s->njobs = 0;
+
+    if(!s->closed) return;
+    int n = 1;
+    for(int i = 1; i < s->nfds; i++){
+        if(s->fds[i].fd < 0){
+            close(-s->fds[i].fd - 1);
+            service_release_client(&s->clients[i]);
+        } else {
+            s->clients[n] = s->clients[i];
+            s->fds[n++] = s->fds[i];
+        }
+    }
+    s->nfds = n;
+    s->closed = 0;
+}
+
+/**
+ * @brief Run the multiplication service on a Unix domain socket until a client requests
+ * a shutdown or the process receives SIGINT or SIGTERM. The OpenMP thread team is created
+ * once on startup and reused for every batch. After the first job of a batch arrived the service waits SERVICE_BATCH_WINDOW_US for
+ * further small jobs of other clients before running the batch.
+ *
+ * @param path
+ * @param row_split block size used for the multiplication
+ * @param col_split block size used for the multiplication
+ * @return int
+ */
+int service_run(const char* path, mat_index row_split, mat_index col_split){
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(strlen(path) >= sizeof(addr.sun_path)) return EXIT_FAILURE;
+    strcpy(addr.sun_path, path);
+
+    int listen_fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    unlink(path);
+    if(listen_fd < 0 || bind(listen_fd, (struct sockaddr*) &addr, sizeof(addr)) != 0 || listen(listen_fd, SERVICE_MAX_CLIENTS) != 0){
+        perror("Cannot listen on socket");
+        if(listen_fd >= 0) close(listen_fd);
+        return EXIT_FAILURE;
+    }
+
+    service_state* s = calloc(1, sizeof(service_state));
+    s->running = 1;
+    s->row_split = row_split;
+    s->col_split = col_split;
+    s->fds[0].fd = listen_fd;
+    s->fds[0].events = POLLIN;
+    s->nfds = 1;
+
+    // stop cleanly on a signal: block it everywhere but in ppoll, which then fails with EINTR
+    struct sigaction action, old_int, old_term;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = service_signal;
+    sigemptyset(&action.sa_mask);
+    sigset_t stop_signals, old_mask;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &stop_signals, &old_mask);
+    s->poll_mask = old_mask;
+    sigdelset(&s->poll_mask, SIGINT);
+    sigdelset(&s->poll_mask, SIGTERM);
+    service_stop = 0;
+    sigaction(SIGINT, &action, &old_int);
+    sigaction(SIGTERM, &action, &old_term);
+
+    // create the thread team up front
+    omp_set_max_active_levels(1);
+    #pragma omp parallel
+    {
+        #pragma omp barrier
+    }
+
+    while(s->running && !service_stop){
+        service_poll(s, NULL);
+
+        // give small jobs of other clients the chance to join the batch
+        if(s->njobs > 0 && s->nfds > 2 && service_is_small(&s->jobs[0])){
+            double deadline = omp_get_wtime() + SERVICE_BATCH_WINDOW_US * 1e-6;
+            double now;
+            while(s->running && !service_stop && s->njobs < SERVICE_MAX_BATCH && (now = omp_get_wtime()) < deadline){
+                struct timespec timeout = {0, (long) ((deadline - now) * 1e9)};
+                service_poll(s, &timeout);
+            }
+        }
+
+        if(s->njobs > 0) service_execute(s);
+        service_finish(s);
+    }
+
+    service_stats stats;
+    service_get_state_stats(s, &stats);
+    fprintf(stdout, "Served %ld requests in %ld batches, latency p50 = %.1f us, p90 = %.1f us, p99 = %.1f us, max = %.1f us\n",
+        stats.count, stats.batches, stats.p50 * 1e6, stats.p90 * 1e6, stats.p99 * 1e6, stats.max * 1e6);
+    fflush(stdout);
+
+    sigaction(SIGINT, &old_int, NULL);
+    sigaction(SIGTERM, &old_term, NULL);
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+
+    for(int i = 1; i < s->nfds; i++){
+        close(s->fds[i].fd < 0 ? -s->fds[i].fd - 1 : s->fds[i].fd);
+        service_release_client(&s->clients[i]);
+    }
+    close(listen_fd);
+    unlink(path);
+    free(s);
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+#ifndef SERVICE_H
+#define SERVICE_H
+
+#include <stddef.h>
+#include <matrix/matrix.h>
+
+#define SERVICE_DEFAULT_SOCKET "/tmp/matrixmul.sock"
+#define SERVICE_NAME_LEN 64
+#define SERVICE_MAX_CLIENTS 64
+#define SERVICE_MAX_BATCH 64
+// time the service waits for further jobs to join a batch of small jobs
+#define SERVICE_BATCH_WINDOW_US 200
+// jobs with at most this many multiply-adds are batched and run one per thread
+#define SERVICE_SMALL_JOB (128L * 128L * 128L)
+// jobs with more multiply-adds are rejected
+#define SERVICE_MAX_WORK ((mat_index) 1 << 50)
+#define SERVICE_MAX_SAMPLES 65536
+// operands which stay mapped per connection
+#define SERVICE_MAX_MAPPINGS 8
+
+typedef enum service_op{
+    SERVICE_OP_MULTIPLY = 1,
+    SERVICE_OP_STATS,
+    SERVICE_OP_SHUTDOWN
+} service_op;
+
+/**
+ * @brief A job sent to the service. For a multiplication the shared memory object shm_name
+ * holds A (m x n), B (n x q) and C (m x q) one after another, C is overwritten.
+ * The service keeps the object mapped until the connection is closed, so a client must not
+ * replace an object by a new one with the same name and size while it is connected.
+ */
+typedef struct service_request{
+    int op;
+    long id;
+    mat_index m;
+    mat_index n;
+    mat_index q;
+    char shm_name[SERVICE_NAME_LEN];
+} service_request;
+
+typedef struct service_stats{
+    long count;
+    long batches;
+    double p50;
+    double p90;
+    double p99;
+    double max;
+} service_stats;
+
+typedef struct service_reply{
+    long id;
+    int status;
+    // time from receiving to answering the request in seconds
+    double latency;
+    service_stats stats;
+} service_reply;
+
+/**
+ * @brief Operands of a multiplication placed in a shared memory object
+ */
+typedef struct service_operands{
+    char name[SERVICE_NAME_LEN];
+    size_t length;
+    float* base;
+    matrix A;
+    matrix B;
+    matrix C;
+} service_operands;
+
+int service_run(const char* path, mat_index row_split, mat_index col_split);
+void service_percentiles(double* samples, long n, service_stats* stats);
+
+int service_connect(const char* path);
+int service_submit(int fd, long id, const service_operands* operands);
+int service_receive(int fd, service_reply* reply);
+int service_get_stats(int fd, service_stats* stats);
+int service_shutdown(int fd);
+int service_operands_length(mat_index m, mat_index n, mat_index q, size_t* length);
+int service_operands_create(service_operands* operands, const char* name, mat_index m, mat_index n, mat_index q);
+void service_operands_close(service_operands* operands);
+int service_client_benchmark(const char* path, mat_index m, mat_index n, mat_index q, int clients, int rounds);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,377 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "summa.h"
+#include <transport/shm_transport.h>
+
+#define MAX(a, b) ( (a) > (b) ? (a) : (b) )
+
+// worker executable for the ranks other than 0, set by the build
+#ifndef SUMMA_WORKER_PATH
+#define SUMMA_WORKER_PATH "summa_worker"
+#endif
+
+typedef struct summa_grid{
+    int rows;
+    int cols;
+    int row;
+    int col;
+} summa_grid;
+
+/**
+ * @brief Choose the most quadratic process grid for the given number of processes
+ *
+ * @param procs
+ * @param rank
+ * @param grid
+ */
+static void summa_grid_init(int procs, int rank, summa_grid* grid){
+    grid->rows = (int) sqrt((double) procs);
+    while(procs % grid->rows != 0) grid->rows--;
+    grid->cols = procs / grid->rows;
+    grid->row = rank / grid->cols;
+    grid->col = rank % grid->cols;
+}
+
+static mat_index extent(mat_index start, mat_index end){
+    return end > start ? end - start : 0;
+}
+
+/**
+ * @brief Sum of the heights of every step-th tile row of a split matrix starting at first
+ *
+ * @param split
+ * @param first
+ * @param step
+ * @return mat_index
+ */
+static mat_index owned_rows(split_matrix* split, int first, int step){
+    mat_index rows = 0;
+    for(mat_index u = first; u < split->rows; u += step){
+        sub_matrix_meta* p = &split->data[MIDX(u, 0, split->cols)];
+        rows += extent(p->row_start, p->row_end);
+    }
+    return rows;
+}
+
+/**
+ * @brief Sum of the widths of every step-th tile column of a split matrix starting at first
+ *
+ * @param split
+ * @param first
+ * @param step
+ * @return mat_index
+ */
+static mat_index owned_cols(split_matrix* split, int first, int step){
+    mat_index cols = 0;
+    for(mat_index v = first; v < split->cols; v += step){
+        cols += extent(split->data[v].col_start, split->data[v].col_end);
+    }
+    return cols;
+}
+
+/**
+ * @brief Copy the tiles of a global matrix which a grid position owns in a 2D block-cyclic
+ * distribution to a densely packed local matrix or back. Row ranges are taken from rows_of and
+ * column ranges from cols_of, so C can be addressed by the tiles of A and B.
+ *
+ * @param global
+ * @param rows_of
+ * @param cols_of
+ * @param grid
+ * @param local
+ * @param local_cols
+ * @param to_global copy from local to global instead
+ */
+static void copy_tiles(matrix* global, split_matrix* rows_of, split_matrix* cols_of, summa_grid* grid, float* local, mat_index local_cols, int to_global){
+    mat_index local_row = 0;
+    for(mat_index u = grid->row; u < rows_of->rows; u += grid->rows){
+        sub_matrix_meta* r = &rows_of->data[MIDX(u, 0, rows_of->cols)];
+        mat_index local_col = 0;
+        for(mat_index v = grid->col; v < cols_of->cols; v += grid->cols){
+            sub_matrix_meta* c = &cols_of->data[v];
+            mat_index width = extent(c->col_start, c->col_end);
+            for(mat_index i = 0; i < extent(r->row_start, r->row_end); i++){
+                float* g = &global->data[MIDX((r->row_start + i), c->col_start, global->cols)];
+                float* l = &local[MIDX((local_row + i), local_col, local_cols)];
+                if(to_global) memcpy(g, l, sizeof(float) * width);
+                else memcpy(l, g, sizeof(float) * width);
+            }
+            local_col += width;
+        }
+        local_row += extent(r->row_start, r->row_end);
+    }
+}
+
+/**
+ * @brief Calculate the size of the broadcast channels and the size per process of the scatter
+ * and gather buffers a SUMMA multiplication needs on the given number of processes.
+ *
+ * @param mult_op
+ * @param procs
+ * @param channel_bytes
+ * @param exchange_bytes large enough for the local tiles of A, B and C of every process
+ */
+static void summa_buffer_sizes(matrix_mult_operation* mult_op, int procs, size_t* channel_bytes, size_t* exchange_bytes){
+    summa_grid grid;
+    summa_grid_init(procs, 0, &grid);
+
+    mat_index max_rows = 0, max_cols = 0, max_depth_A = 0, max_depth_B = 0, panel_depth = 0;
+    for(int r = 0; r < grid.rows; r++){
+        max_rows = MAX(max_rows, owned_rows(&mult_op->split_A, r, grid.rows));
+        max_depth_B = MAX(max_depth_B, owned_rows(&mult_op->split_B, r, grid.rows));
+    }
+    for(int c = 0; c < grid.cols; c++){
+        max_cols = MAX(max_cols, owned_cols(&mult_op->split_B, c, grid.cols));
+        max_depth_A = MAX(max_depth_A, owned_cols(&mult_op->split_A, c, grid.cols));
+    }
+    for(mat_index c = 0; c < mult_op->split_A.cols; c++){
+        panel_depth = MAX(panel_depth, extent(mult_op->split_A.data[c].col_start, mult_op->split_A.data[c].col_end));
+    }
+
+    *channel_bytes = sizeof(float) * panel_depth * MAX(max_rows, max_cols);
+    *exchange_bytes = sizeof(float) * MAX(max_rows * max_cols, MAX(max_rows * max_depth_A, max_depth_B * max_cols));
+}
+
+/**
+ * @brief Scatter the tiles of a global matrix on the root to the processes owning them.
+ * The root packs the tiles of every process into a chunk of chunk_bytes first.
+ *
+ * @param t
+ * @param global only read on the root
+ * @param split
+ * @param chunk_bytes
+ * @param local
+ * @return int
+ */
+static int scatter_tiles(transport* t, matrix* global, split_matrix* split, size_t chunk_bytes, float* local){
+    float* staging = NULL;
+    if(t->rank == 0){
+        staging = malloc(chunk_bytes * t->size + sizeof(float));
+        for(int r = 0; r < t->size; r++){
+            summa_grid owner;
+            summa_grid_init(t->size, r, &owner);
+            float* chunk = (float*) ((char*) staging + r * chunk_bytes);
+            copy_tiles(global, split, split, &owner, chunk, owned_cols(split, owner.col, owner.cols), 0);
+        }
+    }
+    int res = t->ops->scatter(t, 0, staging, chunk_bytes, local);
+    free(staging);
+    return res;
+}
+
+/**
+ * @brief Sizes of the multiplication, sent from rank 0 to all processes
+ */
+typedef struct summa_job{
+    mat_index m;
+    mat_index n;
+    mat_index q;
+    mat_index row_split;
+    mat_index col_split;
+    int status;
+} summa_job;
+
+/**
+ * @brief Perform a SUMMA matrix-matrix multiplication on all processes of the given transport.
+ * The tiles of the block-wise decomposition (see @prepare_matrix_block_mult) are distributed
+ * 2D block-cyclic over a process grid. In each step the owners of a panel of A broadcast it
+ * along their process row and the owners of a panel of B along their process column, while the
+ * panels of the next step are already posted before the local blocked multiplication runs.
+ * A, B, C and the block sizes are only used on rank 0, which scatters the sizes and the tiles
+ * of A and B to their owners and gathers the result into C (C is overwritten). The other
+ * processes can pass NULL. The transport has to be large enough for the multiplication.
+ *
+ * @param t
+ * @param A
+ * @param B
+ * @param C
+ * @param row_split
+ * @param col_split
+ * @param elapsed time of the distributed multiplication without distributing and gathering (can be NULL)
+ * @return int
+ */
+int matrix_summa_mul(transport* t, matrix* A, matrix* B, matrix* C, mat_index row_split, mat_index col_split, double* elapsed){
+    // every process needs the same decomposition but only rank 0 knows the sizes
+    summa_job* jobs = NULL;
+    if(t->rank == 0){
+        matrix_mult_operation check;
+        summa_job job = {A->rows, A->cols, B->cols, row_split, col_split,
+            prepare_matrix_block_mult(A, B, C, row_split, col_split, &check)};
+        if(job.status == EXIT_SUCCESS) close_matrix_mult(&check);
+        jobs = malloc(sizeof(summa_job) * t->size);
+        for(int r = 0; r < t->size; r++) jobs[r] = job;
+    }
+    summa_job job;
+    int res = t->ops->scatter(t, 0, jobs, sizeof(summa_job), &job);
+    free(jobs);
+    if(res != EXIT_SUCCESS || job.status != EXIT_SUCCESS) return EXIT_FAILURE;
+
+    matrix shape_A = {job.m, job.n, NULL};
+    matrix shape_B = {job.n, job.q, NULL};
+    matrix shape_C = {job.m, job.q, NULL};
+    row_split = job.row_split;
+    col_split = job.col_split;
+    matrix_mult_operation mult_op;
+    prepare_matrix_block_mult(&shape_A, &shape_B, &shape_C, row_split, col_split, &mult_op);
+    split_matrix* split_A = &mult_op.split_A;
+    split_matrix* split_B = &mult_op.split_B;
+
+    summa_grid grid;
+    summa_grid_init(t->size, t->rank, &grid);
+    int row_channel = grid.row;
+    int col_channel = grid.rows + grid.col;
+
+    size_t channel_bytes, exchange_bytes;
+    summa_buffer_sizes(&mult_op, t->size, &channel_bytes, &exchange_bytes);
+
+    // distribute: every process only receives the tiles it owns
+    mat_index local_rows = owned_rows(split_A, grid.row, grid.rows);
+    mat_index local_cols = owned_cols(split_B, grid.col, grid.cols);
+    mat_index local_depth_A = owned_cols(split_A, grid.col, grid.cols);
+    float* local_A = malloc(exchange_bytes + sizeof(float));
+    float* local_B = malloc(exchange_bytes + sizeof(float));
+    float* local_C = calloc(exchange_bytes / sizeof(float) + 1, sizeof(float));
+    res |= scatter_tiles(t, A, split_A, exchange_bytes, local_A);
+    res |= scatter_tiles(t, B, split_B, exchange_bytes, local_B);
+
+    // double buffered panels
+    float* panel_A[2];
+    float* panel_B[2];
+    for(int s = 0; s < 2; s++){
+        panel_A[s] = malloc(channel_bytes + sizeof(float));
+        panel_B[s] = malloc(channel_bytes + sizeof(float));
+    }
+
+    // steps over the non-empty tile columns of A with the offsets into the local storage of the owners
+    mat_index steps = 0;
+    mat_index* step_k = malloc(sizeof(mat_index) * (split_A->cols + 1));
+    mat_index* step_offset_A = malloc(sizeof(mat_index) * (split_A->cols + 1));
+    mat_index* step_offset_B = malloc(sizeof(mat_index) * (split_A->cols + 1));
+    mat_index offset_A = 0, offset_B = 0;
+    for(mat_index c = 0; c < split_A->cols; c++){
+        mat_index depth = extent(split_A->data[c].col_start, split_A->data[c].col_end);
+        if(depth == 0) continue;
+        step_k[steps] = c;
+        step_offset_A[steps] = offset_A;
+        step_offset_B[steps] = offset_B;
+        steps++;
+        if(c % grid.cols == grid.col) offset_A += depth;
+        if(c % grid.rows == grid.row) offset_B += depth;
+    }
+
+    transport_request req_A[2], req_B[2];
+
+    t->ops->barrier(t);
+    double start = omp_get_wtime();
+
+    for(mat_index i = 0; i <= steps && res == EXIT_SUCCESS; i++){
+        // post the broadcasts of step i before computing step i - 1
+        if(i < steps){
+            int s = i % 2;
+            mat_index c = step_k[i];
+            mat_index depth = extent(split_A->data[c].col_start, split_A->data[c].col_end);
+            int root_A = c % grid.cols == grid.col;
+            int root_B = c % grid.rows == grid.row;
+
+            if(root_A){
+                for(mat_index r = 0; r < local_rows; r++){
+                    memcpy(&panel_A[s][MIDX(r, 0, depth)], &local_A[MIDX(r, step_offset_A[i], local_depth_A)], sizeof(float) * depth);
+                }
+            }
+            float* buf_B = root_B ? &local_B[MIDX(step_offset_B[i], 0, local_cols)] : panel_B[s];
+
+            res |= t->ops->ibcast(t, row_channel, root_A, grid.cols, panel_A[s], sizeof(float) * local_rows * depth, i + 1, &req_A[s]);
+            res |= t->ops->ibcast(t, col_channel, root_B, grid.rows, buf_B, sizeof(float) * depth * local_cols, i + 1, &req_B[s]);
+        }
+
+        if(i > 0){
+            int s = (i - 1) % 2;
+            mat_index c = step_k[i - 1];
+            mat_index depth = extent(split_A->data[c].col_start, split_A->data[c].col_end);
+            res |= t->ops->wait(t, &req_A[s]);
+            res |= t->ops->wait(t, &req_B[s]);
+
+            if(local_rows > 0 && local_cols > 0){
+                matrix mat_A = {local_rows, depth, panel_A[s]};
+                matrix mat_B = {depth, local_cols, req_B[s].buf};
+                matrix mat_C = {local_rows, local_cols, local_C};
+                matrix_block_mul_inline_omp(&mat_A, &mat_B, &mat_C, row_split, col_split);
+            }
+        }
+    }
+
+    t->ops->barrier(t);
+    if(elapsed != NULL) *elapsed = omp_get_wtime() - start;
+
+    // gather all local results into C on rank 0
+    float* gathered = t->rank == 0 ? malloc(exchange_bytes * t->size + sizeof(float)) : NULL;
+    res |= t->ops->gather(t, 0, local_C, exchange_bytes, gathered);
+    if(t->rank == 0 && res == EXIT_SUCCESS){
+        for(int r = 0; r < t->size; r++){
+            summa_grid owner;
+            summa_grid_init(t->size, r, &owner);
+            float* chunk = (float*) ((char*) gathered + r * exchange_bytes);
+            copy_tiles(C, split_A, split_B, &owner, chunk, owned_cols(split_B, owner.col, owner.cols), 1);
+        }
+    }
+
+    free(gathered);
+    free(step_k);
+    free(step_offset_A);
+    free(step_offset_B);
+    for(int s = 0; s < 2; s++){
+        free(panel_A[s]);
+        free(panel_B[s]);
+    }
+    free(local_A);
+    free(local_B);
+    free(local_C);
+    close_matrix_mult(&mult_op);
+
+    return res == EXIT_SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Perform a SUMMA matrix-matrix multiplication (see @matrix_summa_mul) on procs local
+ * processes which communicate over POSIX shared memory. The calling process is rank 0, the
+ * other ranks run the summa_worker executable (overridable with the environment variable
+ * MATRIXMUL_SUMMA_WORKER). Every process, including the calling one, uses the given number of
+ * OpenMP threads.
+ *
+ * @param A
+ * @param B
+ * @param C
+ * @param row_split
+ * @param col_split
+ * @param procs
+ * @param threads OpenMP threads per process
+ * @param elapsed time of the distributed multiplication without distributing and gathering (can be NULL)
+ * @return int
+ */
+int matrix_summa_mul_shm(matrix* A, matrix* B, matrix* C, mat_index row_split, mat_index col_split, int procs, int threads, double* elapsed){
+    matrix_mult_operation mult_op;
+    if(procs < 1 || threads < 1 || prepare_matrix_block_mult(A, B, C, row_split, col_split, &mult_op) != EXIT_SUCCESS) return EXIT_FAILURE;
+
+    summa_grid grid;
+    summa_grid_init(procs, 0, &grid);
+    size_t channel_bytes, exchange_bytes;
+    summa_buffer_sizes(&mult_op, procs, &channel_bytes, &exchange_bytes);
+    close_matrix_mult(&mult_op);
+
+    char worker_arg[16];
+    snprintf(worker_arg, sizeof(worker_arg), "%d", threads);
+    const char* worker = getenv("MATRIXMUL_SUMMA_WORKER") != NULL ? getenv("MATRIXMUL_SUMMA_WORKER") : SUMMA_WORKER_PATH;
+
+    transport t;
+    if(shm_transport_launch(procs, grid.rows + grid.cols, channel_bytes, MAX(exchange_bytes, sizeof(summa_job)), worker, worker_arg, &t) != EXIT_SUCCESS) return EXIT_FAILURE;
+
+    int max_threads = omp_get_max_threads();
+    omp_set_num_threads(threads);
+    int res = matrix_summa_mul(&t, A, B, C, row_split, col_split, elapsed);
+    omp_set_num_threads(max_threads);
+
+    return shm_transport_join(&t, res);
+}
@@ -0,0 +1,10 @@
+#ifndef SUMMA_H
+#define SUMMA_H
+
+#include <matrix/matrix.h>
+#include <transport/transport.h>
+
+int matrix_summa_mul(transport* t, matrix* A, matrix* B, matrix* C, mat_index row_split, mat_index col_split, double* elapsed);
+int matrix_summa_mul_shm(matrix* A, matrix* B, matrix* C, mat_index row_split, mat_index col_split, int procs, int threads, double* elapsed);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,29 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <omp.h>
+#include "summa.h"
+#include <transport/shm_transport.h>
+
+/**
+ * @brief Worker process of matrix_summa_mul_shm. Started as
+ * "summa_worker <segment name> <rank> <threads>", attaches to the shared memory transport and
+ * takes part in a single SUMMA multiplication. The operands are scattered by rank 0.
+ *
+ * @param argc
+ * @param argv
+ * @return int
+ */
+int main(int argc, char* argv[]){
+    if(argc != 4){
+        fprintf(stderr, "Usage: %s <segment name> <rank> <threads>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    int threads = atoi(argv[3]);
+    omp_set_num_threads(threads > 0 ? threads : 1);
+
+    transport t;
+    if(shm_transport_attach(argv[1], atoi(argv[2]), &t) != EXIT_SUCCESS) return EXIT_FAILURE;
+
+    int res = matrix_summa_mul(&t, NULL, NULL, NULL, 0, 0, NULL);
+    return shm_transport_join(&t, res);
+}
@@ -1,12 +1,25 @@
 #include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <omp.h>
 extern "C" {
     #include <matrix/matrix.h>
+#ifdef WITH_SUMMA
+    #include <summa/summa.h>
+#endif
+#ifdef WITH_SERVICE
+    #include <service/service.h>
+#endif
 }
 #ifdef _WIN32
 #include <Windows.h>
 #else
 #include <unistd.h>
 #include <string.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char** environ;
 #endif
 
 
@@ -15,8 +28,15 @@ TEST_CASE( "Create a matrix", "[matrix]" ) {
 
     REQUIRE( mat.rows == 4 );
     REQUIRE( mat.cols == 5 );
+    REQUIRE( mat.data != NULL );
 
     free_matrix(&mat);
+
+    // sizes which overflow are not allocated
+    matrix huge = create_matrix((mat_index) 1 << 40, (mat_index) 1 << 40);
+    REQUIRE( huge.data == NULL );
+    matrix negative = create_matrix(-1, 5);
+    REQUIRE( negative.data == NULL );
 }
 
 TEST_CASE( "Free a matrix", "[matrix]" ) {
@@ -159,4 +179,362 @@ TEST_CASE( "Matrix initialization", "[matrix]" ) {
     }
 
     free_matrix(&mat_A);
-}
\ No newline at end of file
+}
+
+TEST_CASE( "Freivalds verification", "[matrix]" ) {
+    int n = 4;
+    float a[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+    float res[] = {56, 62, 68, 74, 152, 174, 196, 218, 248, 286, 324, 362, 344, 398, 452, 506};
+
+    matrix mat_A = create_matrix(n, n);
+    matrix mat_C = create_matrix(n, n);
+    memcpy(mat_A.data, a, sizeof(a));
+    memcpy(mat_C.data, res, sizeof(res));
+
+    SECTION( "Correct result passes" ) {
+        REQUIRE( matrix_freivalds_verify(&mat_A, &mat_A, &mat_C, 10) == EXIT_SUCCESS );
+    }
+
+    SECTION( "Wrong element fails" ) {
+        mat_C.data[MIDX(2, 1, n)] += 1.0f;
+        REQUIRE( matrix_freivalds_verify(&mat_A, &mat_A, &mat_C, 10) == EXIT_FAILURE );
+    }
+
+    SECTION( "NaN fails" ) {
+        mat_C.data[MIDX(3, 3, n)] = NAN;
+        REQUIRE( matrix_freivalds_verify(&mat_A, &mat_A, &mat_C, 1) == EXIT_FAILURE );
+    }
+
+    SECTION( "Mismatching dimensions fail" ) {
+        matrix mat_D = create_matrix(3, 4);
+        REQUIRE( matrix_freivalds_verify(&mat_A, &mat_D, &mat_C, 1) == EXIT_FAILURE );
+        free_matrix(&mat_D);
+    }
+
+    SECTION( "Rounding errors of a large random multiplication are tolerated" ) {
+        matrix mat_D = create_matrix(300, 500);
+        matrix mat_E = create_matrix(500, 200);
+        matrix mat_F = create_matrix(300, 200);
+        matrix_random_init(&mat_D, 9.0f);
+        matrix_random_init(&mat_E, 9.0f);
+
+        memset(mat_F.data, 0, sizeof(float) * 300 * 200);
+        matrix_block_mul_inline_omp(&mat_D, &mat_E, &mat_F, 50, 50);
+        REQUIRE( matrix_freivalds_verify(&mat_D, &mat_E, &mat_F, 10) == EXIT_SUCCESS );
+
+        mat_F.data[MIDX(123, 45, 200)] *= 1.1f;
+        REQUIRE( matrix_freivalds_verify(&mat_D, &mat_E, &mat_F, 10) == EXIT_FAILURE );
+
+        free_matrix(&mat_D);
+        free_matrix(&mat_E);
+        free_matrix(&mat_F);
+    }
+
+    SECTION( "A single wrong element of a large multiplication fails" ) {
+        const int m = 16, k = 3000, q = 3000;
+        matrix mat_D = create_matrix(m, k);
+        matrix mat_E = create_matrix(k, q);
+        matrix mat_F = create_matrix(m, q);
+        matrix_random_init(&mat_D, 9.0f);
+        matrix_random_init(&mat_E, 9.0f);
+
+        REQUIRE( matrix_vanilla_mul_omp(&mat_D, &mat_E, &mat_F) == EXIT_SUCCESS );
+        REQUIRE( matrix_freivalds_verify(&mat_D, &mat_E, &mat_F, 10) == EXIT_SUCCESS );
+
+        float value = mat_F.data[MIDX(7, 1234, q)];
+        mat_F.data[MIDX(7, 1234, q)] = 0;
+        REQUIRE( matrix_freivalds_verify(&mat_D, &mat_E, &mat_F, 1) == EXIT_FAILURE );
+
+        mat_F.data[MIDX(7, 1234, q)] = value * 1.5f;
+        REQUIRE( matrix_freivalds_verify(&mat_D, &mat_E, &mat_F, 1) == EXIT_FAILURE );
+
+        mat_F.data[MIDX(7, 1234, q)] = value * 1.1f;
+        REQUIRE( matrix_freivalds_verify(&mat_D, &mat_E, &mat_F, 1) == EXIT_FAILURE );
+
+        free_matrix(&mat_D);
+        free_matrix(&mat_E);
+        free_matrix(&mat_F);
+    }
+
+    SECTION( "A wrong element of a result wider than 65535 fails" ) {
+        const int m = 2, k = 1000, q = 70000;
+        matrix mat_D = create_matrix(m, k);
+        matrix mat_E = create_matrix(k, q);
+        matrix mat_F = create_matrix(m, q);
+        matrix_random_init(&mat_D, 9.0f);
+        matrix_random_init(&mat_E, 9.0f);
+
+        REQUIRE( matrix_vanilla_mul_omp(&mat_D, &mat_E, &mat_F) == EXIT_SUCCESS );
+        REQUIRE( matrix_freivalds_verify(&mat_D, &mat_E, &mat_F, 10) == EXIT_SUCCESS );
+
+        float value = mat_F.data[MIDX(1, 66000, q)];
+        mat_F.data[MIDX(1, 66000, q)] = 0;
+        REQUIRE( matrix_freivalds_verify(&mat_D, &mat_E, &mat_F, 1) == EXIT_FAILURE );
+
+        mat_F.data[MIDX(1, 66000, q)] = value * 1.1f;
+        REQUIRE( matrix_freivalds_verify(&mat_D, &mat_E, &mat_F, 1) == EXIT_FAILURE );
+
+        free_matrix(&mat_D);
+        free_matrix(&mat_E);
+        free_matrix(&mat_F);
+    }
+
+    free_matrix(&mat_A);
+    free_matrix(&mat_C);
+}
+
+#ifdef WITH_SUMMA
+TEST_CASE( "Distributed matrix-matrix multiplication", "[summa]" ) {
+    int n = 4;
+    int block_size = 2;
+    float a[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+    float b[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+    float res[] = {56, 62, 68, 74, 152, 174, 196, 218, 248, 286, 324, 362, 344, 398, 452, 506};
+
+    matrix mat_A = create_matrix(n, n);
+    matrix mat_B = create_matrix(n, n);
+    matrix mat_C = create_matrix(n, n);
+
+    memcpy(mat_A.data, a, sizeof(a));
+    memcpy(mat_B.data, b, sizeof(b));
+
+    SECTION( "SUMMA over shared memory with different process counts" ) {
+        for(int procs = 1; procs <= 4; procs++){
+            memset(mat_C.data, 0, sizeof(res));
+            REQUIRE( matrix_summa_mul_shm(&mat_A, &mat_B, &mat_C, block_size, block_size, procs, 1, NULL) == EXIT_SUCCESS );
+
+            for(int i = 0; i < n*n; i++){
+                REQUIRE( mat_C.data[i] == res[i] );
+            }
+        }
+    }
+
+    SECTION( "SUMMA with more processes than blocks" ) {
+        memset(mat_C.data, 0, sizeof(res));
+        REQUIRE( matrix_summa_mul_shm(&mat_A, &mat_B, &mat_C, block_size, block_size, 6, 1, NULL) == EXIT_SUCCESS );
+
+        for(int i = 0; i < n*n; i++){
+            REQUIRE( mat_C.data[i] == res[i] );
+        }
+    }
+
+    SECTION( "SUMMA with blocks not dividing the matrices" ) {
+        matrix mat_D = create_matrix(7, 5);
+        matrix mat_E = create_matrix(5, 6);
+        matrix mat_F = create_matrix(7, 6);
+        matrix mat_G = create_matrix(7, 6);
+        matrix_simple_init(&mat_D);
+        matrix_simple_init(&mat_E);
+
+        memset(mat_G.data, 0, sizeof(float) * 7 * 6);
+        matrix_vanilla_mul(&mat_D, &mat_E, &mat_G);
+        REQUIRE( matrix_summa_mul_shm(&mat_D, &mat_E, &mat_F, 3, 2, 4, 1, NULL) == EXIT_SUCCESS );
+
+        for(int i = 0; i < 7*6; i++){
+            REQUIRE( mat_F.data[i] == mat_G.data[i] );
+        }
+
+        free_matrix(&mat_D);
+        free_matrix(&mat_E);
+        free_matrix(&mat_F);
+        free_matrix(&mat_G);
+    }
+
+    SECTION( "SUMMA with several threads per process after OpenMP was used" ) {
+        int threads = omp_get_max_threads();
+        omp_set_num_threads(4);
+
+        // small integers keep the results exact for every summation order
+        matrix mat_D = create_matrix(100, 80);
+        matrix mat_E = create_matrix(80, 90);
+        matrix mat_F = create_matrix(100, 90);
+        matrix mat_G = create_matrix(100, 90);
+        for(int i = 0; i < 100*80; i++) mat_D.data[i] = (float) (i % 7 - 3);
+        for(int i = 0; i < 80*90; i++) mat_E.data[i] = (float) (i % 5 - 2);
+
+        // warm up the thread pool of this process before the workers are started
+        REQUIRE( matrix_vanilla_mul_omp(&mat_D, &mat_E, &mat_G) == EXIT_SUCCESS );
+        for(int procs = 2; procs <= 4; procs += 2){
+            REQUIRE( matrix_summa_mul_shm(&mat_D, &mat_E, &mat_F, 16, 16, procs, 2, NULL) == EXIT_SUCCESS );
+            for(int i = 0; i < 100*90; i++){
+                REQUIRE( mat_F.data[i] == mat_G.data[i] );
+            }
+        }
+
+        omp_set_num_threads(threads);
+        free_matrix(&mat_D);
+        free_matrix(&mat_E);
+        free_matrix(&mat_F);
+        free_matrix(&mat_G);
+    }
+
+    SECTION( "SUMMA rejects mismatching dimensions" ) {
+        matrix mat_D = create_matrix(3, 4);
+        REQUIRE( matrix_summa_mul_shm(&mat_A, &mat_D, &mat_C, block_size, block_size, 2, 1, NULL) == EXIT_FAILURE );
+        free_matrix(&mat_D);
+    }
+
+    free_matrix(&mat_A);
+    free_matrix(&mat_B);
+    free_matrix(&mat_C);
+}
+#endif
+
+#ifdef WITH_SERVICE
+/**
+ * @brief Service started as a separate app process together with the operands of its clients.
+ * Everything is released when the test case ends, also if a requirement failed on the way.
+ */
+struct service_process{
+    static const int clients = 3;
+    const char* path = "/tmp/matrixmul-test.sock";
+    pid_t pid = -1;
+    int fds[clients] = {-1, -1, -1};
+    service_operands operands[clients] = {};
+
+    service_process(){
+        unlink(path);
+        setenv("MATRIXMUL_SOCKET", path, 1);
+        const char* argv[] = {APP_PATH, "-d", "1", "-a", "2", "-b", "2", NULL};
+        if(posix_spawn(&pid, APP_PATH, NULL, NULL, (char* const*) argv, environ) != 0) pid = -1;
+        unsetenv("MATRIXMUL_SOCKET");
+    }
+
+    ~service_process(){
+        for(int c = 0; c < clients; c++){
+            if(fds[c] >= 0) close(fds[c]);
+            if(operands[c].base != NULL) service_operands_close(&operands[c]);
+        }
+        if(pid > 0){
+            kill(pid, SIGKILL);
+            waitpid(pid, NULL, 0);
+        }
+        unlink(path);
+    }
+};
+
+TEST_CASE( "Multiplication service", "[service]" ) {
+    const int clients = service_process::clients;
+    int n = 4;
+    float a[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+    float res[] = {56, 62, 68, 74, 152, 174, 196, 218, 248, 286, 324, 362, 344, 398, 452, 506};
+
+    service_process service;
+    REQUIRE( service.pid > 0 );
+    int* fds = service.fds;
+    service_operands* operands = service.operands;
+
+    for(int c = 0; c < clients; c++){
+        // wait for the service to listen
+        for(int retry = 0; (fds[c] = service_connect(service.path)) < 0 && retry < 500; retry++){
+            usleep(10000);
+        }
+        REQUIRE( fds[c] >= 0 );
+
+        char name[SERVICE_NAME_LEN];
+        snprintf(name, sizeof(name), "/matrixmul-test-%ld-%d", (long) getpid(), c);
+        REQUIRE( service_operands_create(&operands[c], name, n, n, n) == EXIT_SUCCESS );
+        memcpy(operands[c].A.data, a, sizeof(a));
+        memcpy(operands[c].B.data, a, sizeof(a));
+        // the service has to overwrite C
+        memset(operands[c].C.data, 0xff, sizeof(res));
+    }
+
+    SECTION( "Concurrent jobs are answered with correct results" ) {
+        for(int c = 0; c < clients; c++){
+            REQUIRE( service_submit(fds[c], c, &operands[c]) == EXIT_SUCCESS );
+        }
+        for(int c = 0; c < clients; c++){
+            service_reply reply;
+            REQUIRE( service_receive(fds[c], &reply) == EXIT_SUCCESS );
+            REQUIRE( reply.id == c );
+            REQUIRE( reply.status == EXIT_SUCCESS );
+
+            for(int i = 0; i < n*n; i++){
+                REQUIRE( operands[c].C.data[i] == res[i] );
+            }
+        }
+
+        service_stats stats;
+        REQUIRE( service_get_stats(fds[0], &stats) == EXIT_SUCCESS );
+        REQUIRE( stats.count == clients );
+        REQUIRE( stats.batches >= 1 );
+        REQUIRE( stats.batches <= clients );
+        REQUIRE( stats.p50 <= stats.p99 );
+        REQUIRE( stats.p99 <= stats.max );
+    }
+
+    SECTION( "Repeated jobs on the same operands see their current content" ) {
+        for(int round = 0; round < 3; round++){
+            // scale A, the service keeps the operands mapped between the jobs
+            for(int i = 0; i < n*n; i++){
+                operands[0].A.data[i] = a[i] * (round + 1);
+            }
+            REQUIRE( service_submit(fds[0], round, &operands[0]) == EXIT_SUCCESS );
+
+            service_reply reply;
+            REQUIRE( service_receive(fds[0], &reply) == EXIT_SUCCESS );
+            REQUIRE( reply.status == EXIT_SUCCESS );
+            for(int i = 0; i < n*n; i++){
+                REQUIRE( operands[0].C.data[i] == res[i] * (round + 1) );
+            }
+        }
+    }
+
+    SECTION( "Jobs with unknown operands fail" ) {
+        service_operands missing = operands[0];
+        strcpy(missing.name, "/matrixmul-test-missing");
+        REQUIRE( service_submit(fds[0], 7, &missing) == EXIT_SUCCESS );
+
+        service_reply reply;
+        REQUIRE( service_receive(fds[0], &reply) == EXIT_SUCCESS );
+        REQUIRE( reply.id == 7 );
+        REQUIRE( reply.status == EXIT_FAILURE );
+    }
+
+    SECTION( "Jobs with overflowing sizes fail" ) {
+        service_operands huge = operands[0];
+        huge.A.rows = (mat_index) 1 << 40;
+        huge.A.cols = (mat_index) 1 << 40;
+        huge.B.cols = (mat_index) 1 << 40;
+        REQUIRE( service_submit(fds[0], 8, &huge) == EXIT_SUCCESS );
+
+        service_reply reply;
+        REQUIRE( service_receive(fds[0], &reply) == EXIT_SUCCESS );
+        REQUIRE( reply.id == 8 );
+        REQUIRE( reply.status == EXIT_FAILURE );
+
+        size_t length;
+        REQUIRE( service_operands_length((mat_index) 1 << 40, (mat_index) 1 << 40, 1, &length) == EXIT_FAILURE );
+        REQUIRE( service_operands_length(n, n, n, &length) == EXIT_SUCCESS );
+        REQUIRE( length == sizeof(float) * 3 * n * n );
+    }
+
+    int status;
+    REQUIRE( service_shutdown(fds[0]) == EXIT_SUCCESS );
+    REQUIRE( waitpid(service.pid, &status, 0) == service.pid );
+    service.pid = -1;
+    REQUIRE( WIFEXITED(status) );
+    REQUIRE( WEXITSTATUS(status) == EXIT_SUCCESS );
+}
+
+TEST_CASE( "Multiplication service stops on SIGTERM", "[service]" ) {
+    service_process service;
+    REQUIRE( service.pid > 0 );
+
+    // wait for the service to listen
+    for(int retry = 0; (service.fds[0] = service_connect(service.path)) < 0 && retry < 500; retry++){
+        usleep(10000);
+    }
+    REQUIRE( service.fds[0] >= 0 );
+
+    int status;
+    REQUIRE( kill(service.pid, SIGTERM) == 0 );
+    REQUIRE( waitpid(service.pid, &status, 0) == service.pid );
+    service.pid = -1;
+    REQUIRE( WIFEXITED(status) );
+    REQUIRE( WEXITSTATUS(status) == EXIT_SUCCESS );
+    // the socket is removed on shutdown
+    REQUIRE( access(service.path, F_OK) != 0 );
+}
+#endif
\ No newline at end of file
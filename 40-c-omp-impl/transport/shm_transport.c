@@ -0,0 +1,409 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sched.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "shm_transport.h"
+
+#define SHM_ALIGN(x) ( ((x) + 63) & ~((size_t) 63) )
+#define SHM_NAME_LEN 64
+
+extern char** environ;
+
+/**
+ * @brief Start of the segment. Describes the layout so that workers can attach by name.
+ */
+typedef struct shm_header{
+    long barrier_count;
+    long barrier_gen;
+    long attached;
+    int nprocs;
+    int channels;
+    size_t channel_bytes;
+    size_t exchange_bytes;
+} shm_header;
+
+typedef struct shm_slot{
+    long seq;
+    long acks;
+} shm_slot;
+
+typedef struct shm_context{
+    char* base;
+    size_t length;
+    size_t channel_bytes;
+    size_t slot_bytes;
+    size_t exchange_bytes;
+    size_t exchange_offset;
+    int channels;
+    pid_t* children;
+} shm_context;
+
+/**
+ * @brief Calculate the offsets of the segment from the sizes in the context
+ *
+ * @param ctx
+ * @param nprocs
+ */
+static void shm_layout(shm_context* ctx, int nprocs){
+    ctx->slot_bytes = SHM_ALIGN(sizeof(shm_slot)) + SHM_ALIGN(ctx->channel_bytes);
+    ctx->exchange_bytes = SHM_ALIGN(ctx->exchange_bytes);
+    ctx->exchange_offset = SHM_ALIGN(sizeof(shm_header)) + (size_t) ctx->channels * 2 * ctx->slot_bytes;
+    ctx->length = ctx->exchange_offset + (size_t) nprocs * ctx->exchange_bytes;
+}
+
+static shm_slot* shm_get_slot(shm_context* ctx, int channel, long seq){
+    size_t index = (size_t) channel * 2 + (size_t) (seq % 2);
+    return (shm_slot*) (ctx->base + SHM_ALIGN(sizeof(shm_header)) + index * ctx->slot_bytes);
+}
+
+static void* shm_slot_data(shm_slot* slot){
+    return (char*) slot + SHM_ALIGN(sizeof(shm_slot));
+}
+
+static char* shm_exchange_chunk(shm_context* ctx, int rank){
+    return ctx->base + ctx->exchange_offset + rank * ctx->exchange_bytes;
+}
+
+/**
+ * @brief Sense-reversing barrier over all processes attached to the segment
+ *
+ * @param t
+ */
+static void shm_barrier(transport* t){
+    shm_context* ctx = t->ctx;
+    shm_header* header = (shm_header*) ctx->base;
+    long gen = __atomic_load_n(&header->barrier_gen, __ATOMIC_ACQUIRE);
+
+    if(__atomic_add_fetch(&header->barrier_count, 1, __ATOMIC_ACQ_REL) == t->size){
+        __atomic_store_n(&header->barrier_count, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&header->barrier_gen, gen + 1, __ATOMIC_RELEASE);
+        return;
+    }
+    while(__atomic_load_n(&header->barrier_gen, __ATOMIC_ACQUIRE) == gen){
+        sched_yield();
+    }
+}
+
+/**
+ * @brief Post a broadcast on the given channel. The root copies its buffer into the slot of
+ * the sequence number as soon as every receiver has consumed the previous broadcast in that slot,
+ * so the broadcast is already in flight when this function returns. Receivers only record the
+ * request and copy the data out of the slot in shm_wait.
+ *
+ * @param t
+ * @param channel
+ * @param is_root
+ * @param group_size number of processes (including the root) which take part in the broadcast
+ * @param buf
+ * @param bytes
+ * @param seq sequence number of the broadcast on this channel, starting at 1
+ * @param req
+ * @return int
+ */
+static int shm_ibcast(transport* t, int channel, int is_root, int group_size, void* buf, size_t bytes, long seq, transport_request* req){
+    shm_context* ctx = t->ctx;
+    if(channel < 0 || channel >= ctx->channels || bytes > ctx->channel_bytes || seq < 1) return EXIT_FAILURE;
+
+    req->channel = channel;
+    req->is_root = is_root;
+    req->group_size = group_size;
+    req->buf = buf;
+    req->bytes = bytes;
+    req->seq = seq;
+
+    if(!is_root || group_size < 2) return EXIT_SUCCESS;
+
+    shm_slot* slot = shm_get_slot(ctx, channel, seq);
+    // wait until all receivers of the last broadcast in this slot are done with it
+    while(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != 0 &&
+          __atomic_load_n(&slot->acks, __ATOMIC_ACQUIRE) < group_size - 1){
+        sched_yield();
+    }
+    __atomic_store_n(&slot->acks, 0, __ATOMIC_RELAXED);
+    memcpy(shm_slot_data(slot), buf, bytes);
+    __atomic_store_n(&slot->seq, seq, __ATOMIC_RELEASE);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Complete a posted broadcast. Blocks receivers until the root has published the data.
+ *
+ * @param t
+ * @param req
+ * @return int
+ */
+static int shm_wait(transport* t, transport_request* req){
+    if(req->is_root || req->group_size < 2) return EXIT_SUCCESS;
+
+    shm_slot* slot = shm_get_slot(t->ctx, req->channel, req->seq);
+    while(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != req->seq){
+        sched_yield();
+    }
+    memcpy(req->buf, shm_slot_data(slot), req->bytes);
+    __atomic_add_fetch(&slot->acks, 1, __ATOMIC_ACQ_REL);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Send bytes from send of the root to buf of every process. The data for rank r is
+ * taken from offset r * bytes.
+ *
+ * @param t
+ * @param root
+ * @param send
+ * @param bytes
+ * @param buf
+ * @return int
+ */
+static int shm_scatter(transport* t, int root, const void* send, size_t bytes, void* buf){
+    shm_context* ctx = t->ctx;
+    if(bytes > ctx->exchange_bytes) return EXIT_FAILURE;
+
+    if(t->rank == root){
+        for(int r = 0; r < t->size; r++){
+            memcpy(shm_exchange_chunk(ctx, r), (const char*) send + r * bytes, bytes);
+        }
+    }
+    shm_barrier(t);
+    memcpy(buf, shm_exchange_chunk(ctx, t->rank), bytes);
+    shm_barrier(t);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Gather bytes from every process into recv of the root. The data of rank r is
+ * placed at offset r * bytes.
+ *
+ * @param t
+ * @param root
+ * @param buf
+ * @param bytes
+ * @param recv
+ * @return int
+ */
+static int shm_gather(transport* t, int root, const void* buf, size_t bytes, void* recv){
+    shm_context* ctx = t->ctx;
+    if(bytes > ctx->exchange_bytes) return EXIT_FAILURE;
+
+    memcpy(shm_exchange_chunk(ctx, t->rank), buf, bytes);
+    shm_barrier(t);
+    if(t->rank == root){
+        for(int r = 0; r < t->size; r++){
+            memcpy((char*) recv + r * bytes, shm_exchange_chunk(ctx, r), bytes);
+        }
+    }
+    shm_barrier(t);
+
+    return EXIT_SUCCESS;
+}
+
+static const transport_ops shm_transport_ops = {
+    shm_ibcast,
+    shm_wait,
+    shm_scatter,
+    shm_gather,
+    shm_barrier
+};
+
+/**
+ * @brief Stop and reap the first count workers
+ *
+ * @param ctx
+ * @param count
+ */
+static void shm_kill_workers(shm_context* ctx, int count){
+    for(int r = 1; r < count; r++){
+        kill(ctx->children[r], SIGKILL);
+        waitpid(ctx->children[r], NULL, 0);
+    }
+}
+
+/**
+ * @brief Create a POSIX shared memory segment and start nprocs - 1 worker processes which attach
+ * to it. The workers are new processes (posix_spawn) and not forks of the calling process, whose
+ * OpenMP runtime would not survive a fork. Each worker is started as
+ * "worker <segment name> <rank> <worker_arg>" and has to call shm_transport_attach.
+ * Returns once all workers are attached; the calling process is rank 0.
+ *
+ * @param nprocs
+ * @param channels number of broadcast channels
+ * @param channel_bytes maximum size of a single broadcast
+ * @param exchange_bytes maximum size per process of a scatter or gather
+ * @param worker path of the worker executable
+ * @param worker_arg passed on to the workers
+ * @param t
+ * @return int
+ */
+int shm_transport_launch(int nprocs, int channels, size_t channel_bytes, size_t exchange_bytes, const char* worker, const char* worker_arg, transport* t){
+    if(nprocs < 1 || channels < 0) return EXIT_FAILURE;
+
+    shm_context* ctx = malloc(sizeof(shm_context));
+    ctx->channels = channels;
+    ctx->channel_bytes = channel_bytes;
+    ctx->exchange_bytes = exchange_bytes;
+    shm_layout(ctx, nprocs);
+    ctx->children = malloc(sizeof(pid_t) * nprocs);
+
+    // the name is only needed until all workers are attached
+    char name[SHM_NAME_LEN];
+    snprintf(name, sizeof(name), "/matrixmul-%ld", (long) getpid());
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if(fd < 0){
+        perror("shm_open");
+        free(ctx->children);
+        free(ctx);
+        return EXIT_FAILURE;
+    }
+    if(ftruncate(fd, ctx->length) != 0){
+        perror("ftruncate");
+        close(fd);
+        shm_unlink(name);
+        free(ctx->children);
+        free(ctx);
+        return EXIT_FAILURE;
+    }
+    ctx->base = mmap(NULL, ctx->length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(ctx->base == MAP_FAILED){
+        perror("mmap");
+        shm_unlink(name);
+        free(ctx->children);
+        free(ctx);
+        return EXIT_FAILURE;
+    }
+
+    // ftruncate zero-fills, so all slots start out empty
+    shm_header* header = (shm_header*) ctx->base;
+    header->nprocs = nprocs;
+    header->channels = channels;
+    header->channel_bytes = channel_bytes;
+    header->exchange_bytes = exchange_bytes;
+
+    t->rank = 0;
+    t->size = nprocs;
+    t->ops = &shm_transport_ops;
+    t->ctx = ctx;
+
+    fflush(stdout);
+    fflush(stderr);
+    int started = 1;
+    for(; started < nprocs; started++){
+        char rank[16];
+        snprintf(rank, sizeof(rank), "%d", started);
+        char* argv[] = {(char*) worker, name, rank, (char*) worker_arg, NULL};
+        if(posix_spawn(&ctx->children[started], worker, NULL, NULL, argv, environ) != 0){
+            perror("posix_spawn");
+            break;
+        }
+    }
+
+    // wait for all workers, a worker which already exited will never attach
+    int failed = started < nprocs;
+    while(!failed && __atomic_load_n(&header->attached, __ATOMIC_ACQUIRE) < nprocs - 1){
+        for(int r = 1; r < nprocs; r++){
+            if(waitpid(ctx->children[r], NULL, WNOHANG) != 0){
+                fprintf(stderr, "Worker %s for rank %d exited before attaching\n", worker, r);
+                failed = 1;
+            }
+        }
+        sched_yield();
+    }
+    shm_unlink(name);
+
+    if(failed){
+        shm_kill_workers(ctx, started);
+        munmap(ctx->base, ctx->length);
+        free(ctx->children);
+        free(ctx);
+        t->ctx = NULL;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Attach a worker process started by shm_transport_launch to the segment
+ *
+ * @param name name of the segment
+ * @param rank
+ * @param t
+ * @return int
+ */
+int shm_transport_attach(const char* name, int rank, transport* t){
+    int fd = shm_open(name, O_RDWR, 0);
+    if(fd < 0){
+        perror("shm_open");
+        return EXIT_FAILURE;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(shm_header)){
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    char* base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(base == MAP_FAILED){
+        perror("mmap");
+        return EXIT_FAILURE;
+    }
+
+    shm_header* header = (shm_header*) base;
+    shm_context* ctx = malloc(sizeof(shm_context));
+    ctx->base = base;
+    ctx->channels = header->channels;
+    ctx->channel_bytes = header->channel_bytes;
+    ctx->exchange_bytes = header->exchange_bytes;
+    ctx->children = NULL;
+    shm_layout(ctx, header->nprocs);
+    if(ctx->length != (size_t) st.st_size || rank < 1 || rank >= header->nprocs){
+        munmap(base, st.st_size);
+        free(ctx);
+        return EXIT_FAILURE;
+    }
+
+    t->rank = rank;
+    t->size = header->nprocs;
+    t->ops = &shm_transport_ops;
+    t->ctx = ctx;
+    __atomic_add_fetch(&header->attached, 1, __ATOMIC_ACQ_REL);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Detach from the transport. Rank 0 additionally waits for all workers.
+ *
+ * @param t
+ * @param status
+ * @return int EXIT_FAILURE if status or, on rank 0, the status of any worker indicates a failure
+ */
+int shm_transport_join(transport* t, int status){
+    shm_context* ctx = t->ctx;
+
+    munmap(ctx->base, ctx->length);
+    if(t->rank == 0){
+        for(int r = 1; r < t->size; r++){
+            int child_status;
+            if(waitpid(ctx->children[r], &child_status, 0) < 0 ||
+               !WIFEXITED(child_status) || WEXITSTATUS(child_status) != EXIT_SUCCESS){
+                status = EXIT_FAILURE;
+            }
+        }
+    }
+    free(ctx->children);
+    free(ctx);
+    t->ctx = NULL;
+
+    return status;
+}
\ No newline at end of file
@@ -0,0 +1,10 @@
+#ifndef SHM_TRANSPORT_H
+#define SHM_TRANSPORT_H
+
+#include <transport/transport.h>
+
+int shm_transport_launch(int nprocs, int channels, size_t channel_bytes, size_t exchange_bytes, const char* worker, const char* worker_arg, transport* t);
+int shm_transport_attach(const char* name, int rank, transport* t);
+int shm_transport_join(transport* t, int status);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <stddef.h>
+
+struct transport;
+
+/**
+ * @brief Handle of a posted broadcast. Filled by ibcast and completed by wait.
+ */
+typedef struct transport_request{
+    int channel;
+    int is_root;
+    int group_size;
+    void* buf;
+    size_t bytes;
+    long seq;
+} transport_request;
+
+/**
+ * @brief Operations a transport has to provide for the distributed multiplication.
+ * A channel is a broadcast group (e.g. one process row of the grid) which is addressed
+ * by an index. Every channel carries one broadcast per sequence number and at most two
+ * broadcasts of a channel can be in flight at the same time (double buffering).
+ * Scatter and gather move one equally sized chunk per process between the root and all
+ * processes, so the input only has to exist on the root.
+ */
+typedef struct transport_ops{
+    int (*ibcast)(struct transport* t, int channel, int is_root, int group_size, void* buf, size_t bytes, long seq, transport_request* req);
+    int (*wait)(struct transport* t, transport_request* req);
+    int (*scatter)(struct transport* t, int root, const void* send, size_t bytes, void* buf);
+    int (*gather)(struct transport* t, int root, const void* buf, size_t bytes, void* recv);
+    void (*barrier)(struct transport* t);
+} transport_ops;
+
+typedef struct transport{
+    int rank;
+    int size;
+    const transport_ops* ops;
+    void* ctx;
+} transport;
+
+#endif
\ No newline at end of file